@@ -0,0 +1,48 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "bot.h"
+#include "game.h"
+#include "session.h"
+#include "tick_sched.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_BOARD_W MAX_W   // default board, server -W up to MAX_WORLD
+#define ARENA_BOARD_H MAX_H
+#define ARENA_BOTS 3      // default bots per arena, server -A
+#define ARENA_VIEW (3 * CHUNK) // view side for players without CMD_SET_VIEW
+
+// Jedna zdieľaná doska pre viac hráčov (session) a botov. Tickuje sa ako
+// jeden uzol plánovača: vyberie príkazy všetkých hráčov, pohne všetkými
+// hadmi naraz a každému pošle RESP_ARENA len s tým, čo je vo výreze
+// okolo jeho hlavy, takže frame nezávisí od veľkosti dosky.
+// lock drží tick aj join/leave, zoznam hráčov sa inak nemení. Frames
+// sa pod ním len zaradia do front, do socketov sa píše až po jeho
+// uvoľnení pod flush_lock, na ktorý čaká arena_leave.
+typedef struct arena {
+    tick_node_t node;
+    int id;               // 1..MAX_ARENAS
+
+    pthread_mutex_t lock;
+    pthread_mutex_t flush_lock; // tick writes queued frames out, players can't leave meanwhile
+    game_t game;
+    session_t *players[MAX_SNAKES]; // by snake slot, NULL for bots and free slots
+    bot_t *bots[MAX_SNAKES];
+    int humans;
+    msg_point_t focus[MAX_SNAKES]; // last head of each player, centre of its view
+
+    unsigned char *out;   // frame being encoded
+    size_t out_cap;
+    uint32_t seq;
+} arena_t;
+
+arena_t *arena_create(int id, int w, int h, int nbots, uint64_t seed); // active, not scheduled yet
+void arena_destroy(arena_t *a);                       // after tsched_remove
+
+int arena_join(arena_t *a, session_t *s);             // slot + RESP_JOINED queued, -1 if full
+int arena_leave(arena_t *a, session_t *s);            // humans left
+
+#endif // ARENA_H
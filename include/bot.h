@@ -0,0 +1,37 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include "game.h"
+
+#include <stdint.h>
+
+#define BOT_NODES 4096    // cells one BFS may visit
+
+// AI hráč: BFS od hlavy cez voľné bunky k ovociu, inak za vlastným
+// chvostom, inak hocijaký voľný sused. Na veľkej doske BFS skončí po
+// BOT_NODES bunkách a had ide k navštívenej bunke najbližšej k ovociu.
+// Navštívené bunky sú v malej hash tabuľke, ktorá sa "maže" zvýšením
+// gen, takže pamäť nezávisí od plochy a tick nealokuje ani nečistí.
+// Cesta sa pamätá a kým ostáva priechodná, BFS sa nerobí.
+typedef struct {
+    int nodes;            // BFS budget, min(board cells, BOT_NODES)
+    int32_t *frontier;    // BFS queue, (y << 16) | x, nodes
+
+    int hash_mask;        // table size - 1, at least 2 * nodes
+    int direct;           // board width if the board fits the table, else 0
+    int32_t *keys;        // (y << 16) | x
+    uint32_t *seen;       // == gen if the slot is used in the current search
+    uint8_t *came_from;   // dir_t that entered the cell
+    uint32_t gen;
+
+    uint8_t *path;        // dirs from the head to the target, nodes
+    int path_len, path_pos;
+    int32_t path_fruit;   // fruit cell the path leads to
+    uint32_t path_epoch;  // game epoch the path was planned in
+} bot_t;
+
+int bot_init(bot_t *b, int cells);                    // 0 ok, -1 out of memory
+void bot_free(bot_t *b);
+dir_t bot_think(bot_t *b, const game_t *g, int snake); // next direction, current dir if stuck
+
+#endif // BOT_H
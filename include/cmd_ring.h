@@ -0,0 +1,43 @@
+#ifndef CMD_RING_H
+#define CMD_RING_H
+
+#include "protocol.h"
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Single-producer/single-consumer fronta príkazov bez zámku.
+// Producent je epoll vlákno (čítanie socketu), konzument tick worker.
+#define CMD_RING_SIZE 64   // power of two
+
+typedef struct {
+    msg_cmd_t slots[CMD_RING_SIZE];
+    alignas(64) atomic_uint head;  // next slot to pop, written by the consumer
+    alignas(64) atomic_uint tail;  // next slot to push, written by the producer
+} cmd_ring_t;
+
+static inline void cmd_ring_init(cmd_ring_t *r) {
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+}
+
+static inline int cmd_ring_push(cmd_ring_t *r, const msg_cmd_t *c) { // 0 ok, -1 full
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (tail - head == CMD_RING_SIZE) return -1;
+    r->slots[tail & (CMD_RING_SIZE - 1)] = *c;
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return 0;
+}
+
+static inline int cmd_ring_pop(cmd_ring_t *r, msg_cmd_t *out) {     // 1 popped, 0 empty
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head == tail) return 0;
+    *out = r->slots[head & (CMD_RING_SIZE - 1)];
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return 1;
+}
+
+#endif // CMD_RING_H
@@ -0,0 +1,163 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "protocol.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MIN_W 10
+#define MIN_H 10
+#define MAX_W 60
+#define MAX_H 40
+#define MAX_WORLD 4096    // arena side; msg_point_t is int16
+
+// doska je rozdelená na štvorcové dlaždice, alokujú sa až pri použití
+#define CHUNK_SHIFT 5
+#define CHUNK (1 << CHUNK_SHIFT)
+#define CHUNK_CELLS (CHUNK * CHUNK)
+
+#define MIN_TIME 10
+#define MAX_TIME 3600
+
+#define TURN_QUEUE 4      // turns buffered between ticks
+#define MAX_SNAKES 16     // snakes on one board (arena)
+
+// obsah bunky v occupancy mriežke; had i je CELL_SNAKE + i
+enum {
+    CELL_FREE = 0,
+    CELL_OBST = 1,
+    CELL_SNAKE = 2
+};
+
+#define CELL_OWNER(v) ((int)(v) - CELL_SNAKE)
+
+// jeden had; telo je ring buffer, ktorý rastie spolu s hadom
+typedef struct {
+    int used;             // slot taken
+    int alive;            // on the board
+    msg_point_t *buf;     // cap points
+    int cap;
+    int head_idx;
+    int len;
+
+    dir_t dir;
+    dir_t turns[TURN_QUEUE]; // pending turns, applied one per tick in order
+    int turn_len;
+    int grow_pending;
+    int score;
+
+    // počítadlá pre delta snapshoty
+    uint32_t pushes;      // heads pushed
+    uint32_t pops;        // tails dropped
+} snake_t;
+
+// Prekážky jednej mapy, len na čítanie. Mapy z map.h sa namapujú raz
+// a všetky hry na nich zdieľajú ten istý obst_map_t, nič sa nekopíruje.
+typedef struct {
+    int w, h;
+    int count;                 // obstacle cells
+    const uint8_t *bits;       // (w*h + 7) / 8 bytes, bit y*w+x (LSB first) = obstacle
+    const msg_point_t *spawns; // snake starts, heading right; may be empty
+    int nspawns;
+} obst_map_t;
+
+// CELL_OBST alebo CELL_FREE na (x, y) mapy
+static inline int obst_cell(const obst_map_t *m, int x, int y) {
+    size_t i = (size_t)y * (size_t)m->w + (size_t)x;
+    return (m->bits[i >> 3] >> (i & 7)) & 1;
+}
+
+// Dlaždica obsadenosti: CELL_* pre CHUNK x CHUNK buniek, prekážky mapy
+// sú do nej rozbalené. Kým na dlaždicu nevstúpi had, neexistuje.
+// Voľné bunky na doske sú v hustej množine s odoberaním výmenou za
+// posledný prvok, mení sa spolu s occ.
+typedef struct {
+    uint8_t occ[CHUNK_CELLS];
+    uint16_t free_cells[CHUNK_CELLS]; // CELL_FREE offsets on the board
+    uint16_t free_pos[CHUNK_CELLS];   // index in free_cells, only for free cells
+    int free_len;
+} tile_t;
+
+// Stav jednej hry (doska, hady, prekážky). Čistá simulácia: žiadne I/O,
+// žiadny globálny stav; čas dodáva volajúci (now_ns, CLOCK_MONOTONIC
+// alebo virtuálny), náhoda ide z rng, takže rovnaký seed + rovnaké
+// vstupy dajú rovnakú hru.
+//
+// Bežná hra má jedného hada (slot 0) a jeho smrť končí hru. V aréne
+// (arena = 1) je hadov viac, všetky sa pohnú naraz v jednom ticku a
+// mŕtvy had len zmizne z dosky.
+//
+// Pamäť závisí od aktivity, nie od plochy: obsadenosť je v dlaždiciach,
+// prekážky v zdieľanej bitovej mape a telá hadov rastú podľa dĺžky.
+// Voľné bunky sa počítajú po dlaždiciach (tile_free, Fenwickov strom
+// free_tree) a existujúca dlaždica má ich zoznam, takže ovocie sa
+// vyberie rovnomerne aj na skoro plnej doske bez prechodu cez plochu.
+typedef struct {
+    int active;           // 1 if the game has been configured and reset
+    int arena;
+
+    int w, h;
+    world_type_t world_type;
+
+    game_mode_t mode;
+    int duration_s;
+    int64_t now_ns;           // clock as of the last reset/tick/pause
+    int64_t start_ns;
+    int64_t pause_start_ns;   // 0 if not paused
+    int64_t paused_total_ns;
+
+    int tiles_w, tiles_h; // board in tiles, rounded up
+    tile_t **tiles;       // tiles_w*tiles_h, NULL = nothing but obstacles there
+    const obst_map_t *obst; // borrowed, NULL = no obstacles
+    int64_t free_count;   // CELL_FREE cells on the board
+    int32_t *tile_free;   // CELL_FREE cells per tile, allocated or not
+    int32_t *tile_base;   // tile_free with no snakes (obstacles only)
+    int32_t *free_tree;   // Fenwick tree over tile_free, 1-based
+    const obst_map_t *base_obst; // tile_base was counted for this map
+    int base_w, base_h;   // and this board size
+
+    snake_t snakes[MAX_SNAKES];
+    int nsnakes;          // slots [0, nsnakes) may be used
+
+    int fruit_x, fruit_y; // -1 when the board is full
+    int paused;
+    int gameover;         // gameover_t, whole game
+
+    uint32_t epoch;       // bumped by game_reset
+
+    uint64_t rng;         // splitmix64 state, see game_seed
+} game_t;
+
+void game_init(game_t *g);                            // one snake, defaults, no allocations
+void game_free(game_t *g);
+void game_seed(game_t *g, uint64_t seed);
+
+int game_set_obstacles(game_t *g, const obst_map_t *m); // borrowed, must match w, h; NULL clears; 0 ok
+int game_reset(game_t *g, int64_t now_ns);            // 0 ok, -1 out of memory
+void game_tick(game_t *g, int64_t now_ns);            // timeout check + one step of every snake
+void game_toggle_pause(game_t *g, int64_t now_ns);
+void game_queue_turn(game_t *g, int snake, dir_t d);
+
+int game_add_snake(game_t *g);                        // arena: slot, -1 if full or out of memory
+void game_remove_snake(game_t *g, int snake);
+int game_respawn(game_t *g, int snake);               // arena: 0 ok, -1 no room
+
+// CELL_* na (x, y), ktoré musí byť na doske
+static inline int game_cell(const game_t *g, int x, int y) {
+    int t = (y >> CHUNK_SHIFT) * g->tiles_w + (x >> CHUNK_SHIFT);
+    int o = ((y & (CHUNK - 1)) << CHUNK_SHIFT) | (x & (CHUNK - 1));
+    if (g->tiles[t]) return g->tiles[t]->occ[o];
+    if (g->obst) return obst_cell(g->obst, x, y);
+    return CELL_FREE;
+}
+
+msg_point_t game_snake_get(const game_t *g, int snake, int i);   // 0 = head
+void game_snake_copy(const game_t *g, int snake, msg_point_t *out); // len points, head first
+msg_rect_t game_view(const game_t *g, int cx, int cy, int vw, int vh); // vw x vh around (cx, cy) moved onto the board, <= 0 = whole side
+int game_snake_clip(const game_t *g, int snake, msg_rect_t r, msg_point_t *out, int *head); // points in r, head first; *head = head among them; out: min(len, r cells + 1)
+int64_t game_elapsed_ns(const game_t *g);             // at now_ns, pauses excluded
+int game_elapsed_s(const game_t *g);
+int game_time_left_s(const game_t *g);                // -1 for standard, rounded up
+
+#endif // GAME_H
@@ -1,16 +1,73 @@
 #ifndef IPC_H
 #define IPC_H
 
+#include "protocol.h"
+
+#include <stdatomic.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 #define SNAKE_SOCK_PATH "/tmp/pos_snake.sock"
+#define SNAKE_LOG_PATH "/tmp/pos_snake.log"  // output of a server started by the client
 
 int ipc_server_listen(const char *path);              // returns listening fd
+int ipc_server_activated(void);                       // socket passed by systemd (LISTEN_FDS), -1 if none
 int ipc_server_accept(int listen_fd);                 // returns connected fd
 int ipc_client_connect(const char *path);             // returns connected fd
+int ipc_set_nonblock(int fd);                         // 0 ok, -1 error
 
 int ipc_send_all(int fd, const void *buf, size_t n);  // 0 ok, -1 error
 int ipc_recv_all(int fd, void *buf, size_t n);        // 0 ok, -1 error
 
+// Rámec na začiatku buf[0, n) bez kopírovania: *payload ukazuje do buf.
+// Dĺžka celého rámca, 0 ak ešte nie je celý, -1 pri inej verzii alebo
+// payloade dlhšom ako max_len.
+ssize_t ipc_frame_parse(const void *buf, size_t n, size_t max_len, msg_hdr_t *h, const unsigned char **payload);
+size_t ipc_cmd_put(void *out, command_t c, int32_t arg); // CMD_FRAME_SIZE bytes written
+
+ssize_t ipc_send_fd(int sock, const void *buf, size_t n, int fd);  // buf with fd attached, bytes sent or -1
+ssize_t ipc_recv_fd(int sock, void *buf, size_t n, int *fd);        // read(); a passed fd goes to *fd
+
+// Snapshoty cez zdieľanú pamäť (memfd) pre klienta na tom istom stroji.
+// Server zapíše každý tick celý rámec RESP_SNAPSHOT do slotu, do ktorého
+// sa práve nečíta (dva sloty, každý so seqlockom), a zvýši frames, na
+// ktorom klient čaká cez futex. Čitateľ smie dáta zo slotu použiť, až
+// keď ipc_shm_read_ok po ich prečítaní potvrdí, že ich zápis nepredbehol;
+// inak ich zahodí.
+#define SHM_SLOTS 2
+
+typedef struct {
+    atomic_uint seq;      // odd while the slot is being written
+    uint32_t len;         // frame bytes in the slot
+} ipc_shm_slot_t;
+
+typedef struct {
+    atomic_uint frames;   // frames published, futex word; newest in slot[frames % SHM_SLOTS]
+    atomic_uint closed;   // the writer is gone
+    uint32_t slot_cap;    // bytes per slot, slots follow this header
+    uint32_t reserved;
+    ipc_shm_slot_t slot[SHM_SLOTS];
+} ipc_shm_t;
+
+typedef struct {
+    int slot;
+    unsigned seq;
+    size_t len;
+} ipc_shm_read_t;
+
+int ipc_shm_create(size_t slot_cap, ipc_shm_t **out, size_t *size); // writer, memfd or -1
+ipc_shm_t *ipc_shm_map(int fd, size_t *size);                       // reader, read-only; NULL on a bad segment
+void ipc_shm_unmap(ipc_shm_t *m, size_t size);
+void ipc_shm_publish(ipc_shm_t *m, const void *frame, size_t len);  // single writer
+void ipc_shm_close(ipc_shm_t *m);                                   // closed + wake the reader
+int ipc_shm_wait(ipc_shm_t *m, unsigned seen, int timeout_ms);      // until frames != seen, 0 or -1 (timeout, signal)
+
+// Najnovší frame bez kopírovania; NULL ak ešte nie je alebo sa práve
+// zapisuje. Čo sa z neho prečítalo, platí, len ak potom (po celom
+// čítaní) ipc_shm_read_ok vráti 1.
+const unsigned char *ipc_shm_read_begin(const ipc_shm_t *m, ipc_shm_read_t *r);
+int ipc_shm_read_ok(const ipc_shm_t *m, const ipc_shm_read_t *r);
+
 #endif // IPC_H
 
@@ -0,0 +1,72 @@
+#ifndef MAP_H
+#define MAP_H
+
+#include "game.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Načítanie máp zo súborov; simulácia (game.c) sama nič nečíta.
+//
+// Textová mapa: riadok na riadok dosky, '#' = prekážka, 'S' = štart hada
+// (hlava, telo ide doľava), čokoľvek iné = voľno. Rozmer je daný súborom.
+//
+// Skompilovaná mapa (MAP_EXT, little endian, číta sa priamo z mmap):
+//   map_file_t, potom nspawns msg_point_t, potom bitová mriežka
+//   (w*h + 7) / 8 bajtov, bit y*w+x od LSB = prekážka.
+#define MAP_MAGIC "SMAP"
+#define MAP_VERSION 1
+#define MAP_EXT ".smap"
+#define MAPS_FILE "assets/maps.txt"
+
+#define MAX_MAPS 32
+#define MAP_NAME 32
+#define MAX_MAP_SPAWNS 256
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t w, h;
+    uint16_t nspawns;
+    uint32_t obst_count;
+    uint64_t hash;        // FNV-1a of spawns + grid
+} map_file_t;
+
+// Jedna mapa. obst ukazuje do mmap súboru (alebo do mem pri textovej
+// mape) a hry ju len požičiavajú, takže musí prežiť všetky hry na nej.
+typedef struct {
+    char name[MAP_NAME];
+    obst_map_t obst;
+    uint64_t hash;
+    void *base;           // mmap of the file, NULL if built from text
+    size_t size;
+    void *mem;            // spawns + grid of a text or received map
+    unsigned char *wire;  // whole RESP_MAP message, built once by the catalog
+    size_t wire_len;
+} map_t;
+
+// horná hranica RLE behov z protocol.h pre cells buniek (varint <= 4 B)
+#define MAP_RLE_BOUND(cells) (4 * ((size_t)(cells) + 1))
+
+map_t *map_load_text(const char *path);            // NULL on error
+int map_write(const map_t *m, const char *path);   // MAP_EXT file, 0 ok
+map_t *map_open(const char *path);                 // mmap read-only, NULL on error or bad file
+void map_free(map_t *m);
+
+int map_build_wire(map_t *m);                      // fills wire, 0 ok
+map_t *map_from_wire(const msg_map_t *hdr, const msg_point_t *spawns, const uint8_t *rle); // NULL on bad runs or hash
+
+// Katalóg: MAPS_FILE, riadok "meno súbor" so súborom MAP_EXT vedľa
+// zoznamu, '#' začína komentár. Mapy sa otvoria raz pri načítaní a
+// vtedy sa im zakóduje aj RESP_MAP.
+typedef struct {
+    map_t *maps[MAX_MAPS];
+    int n;
+} map_catalog_t;
+
+int map_catalog_load(map_catalog_t *c, const char *list);        // maps loaded, -1 if the list is unreadable
+const map_t *map_catalog_get(const map_catalog_t *c, int id);    // 1..n, NULL otherwise
+const map_t *map_catalog_find(const map_catalog_t *c, uint64_t hash); // NULL if none
+void map_catalog_free(map_catalog_t *c);
+
+#endif // MAP_H
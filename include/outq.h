@@ -0,0 +1,58 @@
+#ifndef OUTQ_H
+#define OUTQ_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Ohraničená výstupná fronta jedného klienta na neblokujúcom sockete.
+// Keď klient nestíha: keyframe nahradí všetky ešte neodoslané frames,
+// snapshot sa pri plnej fronte zahodí a nastaví sa resync, aby ďalší
+// frame bol keyframe. Riadiace správy (BYE) sa nezahadzujú nikdy: pri
+// plnej fronte vytlačia neodoslané snapshoty, a ak je plná samých
+// riadiacich správ, klient nečíta ani odpovede a berie sa ako mŕtvy.
+#define OUTQ_MAX 8
+
+typedef enum {
+    OUTQ_DELTA = 0,   // droppable, depends on the previous frame
+    OUTQ_KEY   = 1,   // self-contained, replaces unsent frames
+    OUTQ_CTRL  = 2    // never dropped or replaced, evicts snapshots from a full queue
+} outq_kind_t;
+
+// Frame zakódovaný raz a zaradený do viacerých front (diváci jednej hry).
+// Každá fronta drží referenciu, kým ho neodošle alebo nezahodí.
+typedef struct {
+    atomic_int refs;
+    size_t len;
+    unsigned char data[];
+} outq_shared_t;
+
+typedef struct {
+    unsigned char *data;
+    size_t len, cap;
+    outq_kind_t kind;
+    outq_shared_t *shared; // non-NULL: bytes are shared->data, data stays a spare buffer
+} outq_frame_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    outq_frame_t frames[OUTQ_MAX]; // [0, count) queued, the rest are spare buffers
+    int count;
+    size_t head_off;               // bytes of frames[0] already written
+    uint64_t dropped;
+    atomic_int resync;             // a snapshot was dropped, send a keyframe next
+} outq_t;
+
+void outq_init(outq_t *q);
+void outq_free(outq_t *q);
+
+int outq_send(outq_t *q, int fd, const void *data, size_t len, outq_kind_t kind); // 0 ok, -1 dead socket or full of CTRL
+int outq_flush(outq_t *q, int fd);                                                 // 0 ok, -1 dead socket
+int outq_pending(outq_t *q);                                                       // frames not fully written
+
+outq_shared_t *outq_shared_new(const void *data, size_t len);                      // one reference, NULL on error
+void outq_shared_put(outq_shared_t *b);                                            // drop a reference
+int outq_send_shared(outq_t *q, int fd, outq_shared_t *b, outq_kind_t kind);      // like outq_send, takes a reference
+
+#endif // OUTQ_H
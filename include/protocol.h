@@ -14,14 +14,33 @@ typedef enum {
     CMD_SET_SIZE  = 7,     // arg: (w << 16) | (h & 0xFFFF)
     CMD_SET_MODE  = 8,     // arg: game_mode_t
     CMD_SET_TIME  = 9,     // arg: seconds
-    CMD_BACK_TO_MENU = 10  // end session, return to menu
+    CMD_BACK_TO_MENU = 10, // end session, return to menu
+    CMD_SET_DELTA = 11,    // arg: DELTA_VERSION understood by the client, 0 = snapshots only
+    CMD_KEYFRAME  = 12,    // ask for a full RESP_SNAPSHOT
+    CMD_SET_TICK  = 13,    // arg: tick period in ms, MIN_TICK_MS..MAX_TICK_MS
+    CMD_JOIN_ARENA = 14,   // arg: arena 1..MAX_ARENAS, instead of the game config
+    CMD_SET_VIEW  = 15,    // arg: (cols << 16) | rows the client can draw, 0 = whole board
+    CMD_SET_MAP   = 16,    // arg: map 1..n from the server's catalog, before CMD_SET_WORLD, default 1
+    CMD_GET_MAP   = 17,    // send RESP_MAP, after RESP_MAP_INFO for a map not in the client's cache
+    CMD_SPECTATE  = 18,    // arg: session id to watch, instead of the game config; RESP_BYE if there is no such game
+    CMD_SET_SHM   = 19     // arg: 1 = frames through shared memory (RESP_SHM), before the game starts
 } command_t;
 
+#define MIN_TICK_MS 30
+#define MAX_TICK_MS 1000
+#define MAX_ARENAS 8
+
 //odpovede servera
 typedef enum {
     RESP_PONG     = 100,
-    RESP_BYE      = 101,
-    RESP_SNAPSHOT = 200
+    RESP_BYE      = 101,  // no payload
+    RESP_JOINED   = 102,  // msg_joined_t
+    RESP_MAP_INFO = 103,  // msg_map_t, once at the start of an obstacle game
+    RESP_MAP      = 104,  // msg_map_t + nspawns msg_point_t + rle_len bytes
+    RESP_SHM      = 105,  // no payload, the segment's fd comes with it (SCM_RIGHTS); no frames on the socket after it
+    RESP_SNAPSHOT = 200,  // keyframe: msg_snapshot_t + npoints msg_point_t
+    RESP_DELTA    = 201,  // msg_delta_t, applies on top of the previous frame
+    RESP_ARENA    = 202   // msg_arena_t + nsnakes msg_arena_snake_t + their points in the view
 } response_t;
 
 typedef enum {
@@ -41,29 +60,68 @@ typedef enum {
     MODE_TIMED = 2
 } game_mode_t;
 
-//správa klient → server
+typedef enum {
+    GAMEOVER_NONE = 0,
+    GAMEOVER_LOST = 1,
+    GAMEOVER_WON  = 2     // snake filled every free cell
+} gameover_t;
+
+// Rámec: každá správa v oboch smeroch je msg_hdr_t a za ním len bajtov
+// payloadu. type je command_t alebo response_t. Rámec neznámeho typu
+// príjemca preskočí podľa len, iná verzia ukončí spojenie. Do jedného
+// write() sa môže poskladať viac rámcov (napr. celý config z menu).
+#define PROTO_VERSION 1
+#define MAX_FRAME_LEN (16u << 20)  // payload sanity limit
+
+typedef struct {
+    uint16_t type;
+    uint8_t version;     // PROTO_VERSION
+    uint8_t flags;       // 0, reserved
+    uint32_t len;        // payload bytes that follow
+} msg_hdr_t;
+
+static inline msg_hdr_t msg_hdr(int type, uint32_t len) {
+    msg_hdr_t h = {(uint16_t)type, PROTO_VERSION, 0, len};
+    return h;
+}
+
+// príkaz klienta: payload je int32_t arg, prípadné bajty navyše sa ignorujú
+#define CMD_FRAME_SIZE (sizeof(msg_hdr_t) + sizeof(int32_t))
+
+// príkaz po dekódovaní z rámca (cmd_ring, záznamy hier)
 typedef struct {
     int32_t cmd;
     int32_t arg;
 } msg_cmd_t;
 
+//správy server → klient
+
+// obdĺžnik buniek na doske
 typedef struct {
-    int32_t resp;
-} msg_resp_t;
+    int32_t x, y;
+    int32_t w, h;
+} msg_rect_t;
 
-//správy server → klient
+// Keyframe nesie len body hada vo výreze view (CMD_SET_VIEW + okraj,
+// okolo hlavy). Kým npoints < snake_len, server delty neposiela.
+// Divák (CMD_SPECTATE) dostáva ten istý prúd RESP_SNAPSHOT/RESP_DELTA,
+// ale vždy s celou doskou, a pri prekážkach najprv RESP_MAP_INFO.
 typedef struct {
     int32_t w, h;
     int32_t score;
     int32_t paused;
-    int32_t gameover;
-    int32_t fruit_x, fruit_y;
+    int32_t gameover;    // gameover_t
+    int32_t fruit_x, fruit_y; // -1 if there is no fruit
 
-    int32_t snake_len;
+    int32_t snake_len;   // whole snake
+    msg_rect_t view;
+    int32_t npoints;     // points inside view that follow, head first
 
     int32_t mode;        // MODE_*
     int32_t elapsed_s;
     int32_t time_left_s; // -1 for standard
+
+    uint32_t seq;        // frame counter shared with RESP_DELTA
 } msg_snapshot_t;
 
 typedef struct {
@@ -71,4 +129,71 @@ typedef struct {
     int16_t y;
 } msg_point_t;
 
+// Delta frame: najprv sa z chvosta odoberie tail_pops bodov, potom
+// (pri DELTA_HEAD) pribudne nová hlava. Ak seq nenadväzuje na predošlý
+// frame, klient si vyžiada keyframe cez CMD_KEYFRAME.
+#define DELTA_VERSION 1
+
+enum {
+    DELTA_HEAD  = 1 << 0,  // push .head
+    DELTA_FRUIT = 1 << 1,  // fruit moved to .fruit
+    DELTA_SCORE = 1 << 2   // score += .score_delta
+};
+
+typedef struct {
+    uint8_t version;       // DELTA_VERSION
+    uint8_t flags;         // DELTA_*
+    uint16_t tail_pops;
+    uint32_t seq;
+    msg_point_t head;
+    msg_point_t fruit;
+    int16_t score_delta;
+    uint8_t paused;
+    uint8_t gameover;      // gameover_t
+    int32_t elapsed_s;
+    int32_t time_left_s;
+} msg_delta_t;
+
+// Aréna: frame pre jedného hráča. Za hlavičkou idú záznamy hadov, ktoré
+// majú bod vo výreze view okolo hlavy hráča (vlastný had vždy), a potom
+// ich body v tom istom poradí, od hlavy, len tie vo výreze. Ovocie ide vždy.
+typedef struct {
+    int32_t arena;
+    int32_t slot;        // own snake in msg_arena_snake_t.slot
+} msg_joined_t;
+
+typedef struct {
+    uint32_t seq;
+    int32_t w, h;        // whole board
+    msg_rect_t view;     // cells sent, inside the board
+    int32_t fruit_x, fruit_y;
+    int32_t elapsed_s;
+    int32_t nsnakes;
+} msg_arena_t;
+
+enum {
+    ARENA_SNAKE_BOT = 1 << 0,
+    ARENA_SNAKE_HEAD = 1 << 1  // the first point sent is the head
+};
+
+typedef struct {
+    int16_t slot;
+    uint8_t alive;
+    uint8_t flags;       // ARENA_SNAKE_*
+    int32_t score;
+    int32_t len;         // whole snake, 0 while dead
+    int32_t npoints;     // points in the view that follow
+} msg_arena_snake_t;
+
+// Mapa prekážok: RESP_MAP_INFO ohlási hash, klient s mapou v cache
+// nepotrebuje nič, inak pošle CMD_GET_MAP a príde RESP_MAP. Mriežka
+// ide ako striedavé behy voľných a obsadených buniek (po riadkoch, od
+// voľného behu), každý ako LEB128 varint, spolu w*h buniek.
+typedef struct {
+    uint64_t hash;       // FNV-1a of spawns + bit grid, key of the client's map cache
+    int32_t w, h;
+    int32_t nspawns;
+    int32_t rle_len;     // bytes of runs after the spawns in RESP_MAP
+} msg_map_t;
+
 #endif
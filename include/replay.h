@@ -0,0 +1,73 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "game.h"
+#include "map.h"
+#include "protocol.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Záznam jednej session: seed, config a vstupy s číslom ticku. Herný čas
+// ticku je start + súčet periód (tick_node_t.clock_ns, aj keď server
+// meškal), takže prehratie cez game_tick dá bit-exact rovnakú hru bez
+// socketov a bez čakania.
+//
+// Súbor: hlavička rec_header_t (little endian), potom záznamy
+//   varint((tick_delta << 3) | op) [varint arg]
+// kde tick_delta je počet tickov od predchádzajúceho záznamu a op:
+//   0-3  CMD_DIR, smer - 1 (2 bity, bez argumentu)
+//   4    CMD_TOGGLE_PAUSE
+//   5    CMD_RESTART
+//   6    CMD_SET_TICK, arg = ms
+//   7    koniec, arg = score, potom varint pushes, varint pops, u8 gameover
+#define REC_MAGIC "SNKR"
+#define REC_VERSION 3
+#define REC_EXT ".snkrec"
+
+enum {
+    REC_OP_DIR = 0,       // + (dir - 1)
+    REC_OP_PAUSE = 4,
+    REC_OP_RESTART = 5,
+    REC_OP_SET_TICK = 6,
+    REC_OP_END = 7
+};
+
+typedef struct {
+    uint64_t seed;        // game rng state at commit
+    uint64_t map_hash;    // map_t.hash for WORLD_OBSTACLES, else 0
+    uint8_t mode;         // game_mode_t
+    uint8_t world;        // world_type_t
+    uint16_t w, h;
+    uint16_t duration_s;
+    uint16_t tick_ms;     // period in effect at the first tick
+} rec_header_t;
+
+typedef struct {
+    FILE *f;
+    uint64_t tick;        // ticks run so far
+    uint64_t last;        // tick of the previous record
+} recorder_t;
+
+recorder_t *rec_open(const char *path, const rec_header_t *h); // NULL on error
+void rec_cmd(recorder_t *r, const msg_cmd_t *cmd);  // before game_tick; non-game commands ignored
+void rec_tick(recorder_t *r);                       // after game_tick
+void rec_close(recorder_t *r, const game_t *g);     // end record with the final state, frees r
+
+typedef struct {
+    rec_header_t hdr;
+    uint64_t ticks;
+    uint64_t events;
+    int64_t sim_ns;       // game time covered by the replay
+    int score;
+    uint32_t pushes, pops;
+    int gameover;
+    int ended;            // log had an end record (session closed cleanly)
+    int match;            // final state equals the end record
+} replay_result_t;
+
+// prehrá záznam z pamäte; mapa pre WORLD_OBSTACLES sa hľadá v maps podľa map_hash
+int replay_run(const uint8_t *data, size_t len, const map_catalog_t *maps, replay_result_t *out); // 0 ok, -1 bad log or unknown map
+
+#endif // REPLAY_H
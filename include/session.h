@@ -0,0 +1,135 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "bot.h"
+#include "cmd_ring.h"
+#include "game.h"
+#include "ipc.h"
+#include "map.h"
+#include "outq.h"
+#include "protocol.h"
+#include "replay.h"
+#include "tick_sched.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_SESSIONS 1024
+#define TICK_MS 120
+#define KEYFRAME_TICKS 50  // full snapshot at least this often with deltas on
+#define VIEW_MARGIN 4      // cells sent beyond the client's view on each side
+#define SESSION_INBUF 1024 // command frames read at once, a longer frame closes the connection
+
+typedef enum {
+    SESSION_OK = 0,
+    SESSION_CLOSE = 1      // connection ended, drop the session
+} session_rc_t;
+
+// životný cyklus pripojenia
+typedef enum {
+    SESSION_AWAIT_CONFIG = 0, // menu: config is staged in cfg, game untouched
+    SESSION_ACTIVE = 1,       // game committed, owned by the tick worker
+    SESSION_ENDED = 2,        // BYE sent, waiting to be removed
+    SESSION_WATCHING = 3      // spectator, frames come from the watched session
+} session_state_t;
+
+struct arena;
+
+// nastavenia z menu, kým nie sú kompletné
+typedef struct {
+    int arena;            // CMD_JOIN_ARENA, 0 = own game
+    game_mode_t mode;
+    int duration_s;
+    world_type_t world_type;
+    int map;              // CMD_SET_MAP, 0 = first in the catalog
+    int watch;            // CMD_SPECTATE, session id, 0 = play
+    int shm;              // CMD_SET_SHM
+    int w, h;
+    int got_mode, got_time, got_world, got_size;
+} session_config_t;
+
+// Kódovanie jedného prúdu snapshotov a delt: čo už prijímateľ má.
+// Hráč má svoj (výrez okolo hlavy), diváci jednej hry zdieľajú druhý.
+typedef struct {
+    int delta_version;    // 0 = full snapshot every tick
+    int need_keyframe;
+    int since_keyframe;
+    uint32_t seq;
+    msg_snapshot_t last;
+    uint32_t last_epoch, last_pushes, last_pops;
+    int last_culled;      // last keyframe left points out, no deltas on top of it
+
+    int view_w, view_h;   // CMD_SET_VIEW + 2 * VIEW_MARGIN, 0 = whole board
+
+    unsigned char *out;   // encoded frame, reused every tick
+    size_t out_cap;
+    outq_kind_t out_kind;
+} snap_enc_t;
+
+// Jedno pripojenie klienta a jeho hra. Kým sa hra nespustí, session
+// patrí epoll vláknu; potom stav hry mení len tick worker a príkazy
+// od klienta k nemu idú cez cmds. state číta a mení len epoll vlákno.
+typedef struct session {
+    int id;
+    int fd;               // -1 if no client
+
+    session_state_t state;
+    session_config_t cfg;
+
+    game_t game;
+    cmd_ring_t cmds;      // epoll thread -> tick worker
+    uint64_t cmds_dropped;
+
+    const map_catalog_t *maps; // shared, obstacle worlds fail without it
+    const map_t *map;     // from maps once the game is committed, NULL = no obstacles
+    const char *rec_dir;  // NULL = no recording
+    recorder_t *rec;      // written by the tick worker, closed in session_destroy
+    bot_t *bot;           // NULL = human player
+
+    struct arena *arena;  // NULL = own game; cmds are drained by the arena tick
+    int slot;             // snake in arena->game
+
+    unsigned char inbuf[SESSION_INBUF]; // frames read, the last one maybe incomplete
+    size_t in_len;
+
+    outq_t outq;          // non-blocking socket writes
+    snap_enc_t enc;       // frames for this client
+    ipc_shm_t *shm;       // NULL = frames go to outq
+    size_t shm_size;
+
+    // Diváci: frame pre nich sa zakóduje raz za tick (watch_enc, celá
+    // doska) a do ich front ide ten istý outq_shared_t. Zoznam mení epoll
+    // vlákno a tick ho prechádza, oboje pod watch_lock.
+    pthread_mutex_t watch_lock;
+    struct session **watchers;
+    int nwatchers, watchers_cap;
+    snap_enc_t watch_enc;
+
+    // divák: koho sleduje a či dostáva delty (watch_lock sledovaného)
+    struct session *watching;
+    int watch_new;        // no keyframe yet
+    int watch_slow;       // dropped a frame, keyframes only until its queue drains
+
+    tick_node_t node;     // period: TICK_MS or CMD_SET_TICK
+} session_t;
+
+session_t *session_create(int id, int fd);
+void session_destroy(session_t *s);                   // closes fd
+
+session_rc_t session_on_readable(session_t *s);       // read until EAGAIN + dispatch commands
+session_rc_t session_on_writable(session_t *s);       // flush the outbound queue
+session_rc_t session_on_cmd(session_t *s, const msg_cmd_t *cmd);
+int session_attach_bot(session_t *s);                 // after config is committed, 0 ok
+void session_set_view(session_t *s, int32_t arg);     // CMD_SET_VIEW, by the owner of the game
+void session_tick(session_t *s);                      // drain cmds, one game step at node.clock_ns, snapshot
+size_t session_encode_snapshot(session_t *s);         // keyframe into s->out, 0 if inactive
+size_t session_encode_frame(session_t *s);            // keyframe or delta into s->out
+void session_send_frame(session_t *s);                // encode + queue, without ticking
+
+int session_watch(session_t *w, session_t *target);   // w becomes a spectator of target, 0 ok
+void session_unwatch(session_t *w);                   // before w is destroyed
+session_t **session_drop_watchers(session_t *s, int *n); // RESP_BYE to all spectators, after s left the scheduler; returns them, caller frees the array
+
+#endif // SESSION_H
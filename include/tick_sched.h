@@ -0,0 +1,73 @@
+#ifndef TICK_SCHED_H
+#define TICK_SCHED_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Uzly (session, aréna) sú rozdelené do shardov, každý shard má vlastné
+// vlákno a min-heap podľa deadline. Shard, ktorý mešká viac ako
+// STEAL_LAG_NS, zobudí spiace vlákno a to si od neho prevezme uzol.
+#define STEAL_LAG_NS 2000000LL
+
+// Čokoľvek, čo sa tickuje s periódou; vkladá sa do vlastníka a ten sa
+// z callbacku získa cez TNODE_OWNER.
+typedef struct tick_node tick_node_t;
+
+struct tick_node {
+    void (*tick)(tick_node_t *n); // one step at clock_ns, on a worker thread
+    atomic_int shard;     // -1 if not scheduled
+    int heap_idx;         // -1 while being ticked
+    int removing;
+    int64_t deadline_ns;  // CLOCK_MONOTONIC, when the tick is due; skips missed periods
+    int64_t clock_ns;     // game clock of the tick: first deadline + one period per tick
+    int64_t period_ns;    // written only by the owner
+};
+
+#define TNODE_OWNER(n, type, member) ((type *)(void *)((char *)(n) - offsetof(type, member)))
+
+typedef struct {
+    int sessions;         // nodes: sessions and arenas
+    uint64_t ticks;
+    uint64_t late;        // ticks started more than one period late
+    uint64_t stolen;      // sessions taken over from a lagging shard
+    int64_t lag_avg_ns;
+    int64_t lag_max_ns;
+} shard_stats_t;
+
+typedef struct tick_sched tick_sched_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;  // new session, removal done, shutdown
+    pthread_t th;
+    int index;
+    tick_sched_t *owner;
+
+    tick_node_t **heap;
+    int heap_len, heap_cap;
+    atomic_int count;     // heap + in-flight; written under lock
+    atomic_int sleeping;  // worker waits on cond, a lagging shard may wake it
+
+    uint64_t ticks, late, stolen;
+    int64_t lag_sum_ns, lag_max_ns;
+} shard_t;
+
+struct tick_sched {
+    shard_t *shards;
+    int nshards;
+    volatile int running;
+};
+
+int64_t mono_ns(void);
+void tnode_init(tick_node_t *n, void (*tick)(tick_node_t *n), int64_t period_ns);
+
+int tsched_start(tick_sched_t *ts, int nthreads);     // 0 ok, -1 error
+void tsched_stop(tick_sched_t *ts);                   // joins workers
+
+void tsched_add(tick_sched_t *ts, tick_node_t *n);    // first tick at deadline_ns, or one period from now if 0
+void tsched_remove(tick_sched_t *ts, tick_node_t *n); // waits for an in-flight tick
+void tsched_stats(tick_sched_t *ts, int shard, shard_stats_t *out, int reset);
+
+#endif // TICK_SCHED_H
@@ -0,0 +1,227 @@
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void arena_tick(tick_node_t *n);
+
+arena_t *arena_create(int id, int w, int h, int nbots, uint64_t seed) {
+    arena_t *a = (arena_t *)calloc(1, sizeof(*a));
+    if (!a) return NULL;
+    a->id = id;
+    pthread_mutex_init(&a->lock, NULL);
+    pthread_mutex_init(&a->flush_lock, NULL);
+    tnode_init(&a->node, arena_tick, (int64_t)TICK_MS * 1000000LL);
+
+    game_t *g = &a->game;
+    game_init(g);
+    game_remove_snake(g, 0); // aréna začína prázdna
+    game_seed(g, seed);
+    g->arena = 1;
+    g->mode = MODE_STANDARD;
+    g->world_type = WORLD_WRAP;
+    g->w = w;
+    g->h = h;
+
+    if (nbots > MAX_SNAKES - 1) nbots = MAX_SNAKES - 1; // aspoň jedno miesto pre človeka
+    for (int i = 0; i < nbots; i++) {
+        int slot = game_add_snake(g);
+        bot_t *b = (bot_t *)malloc(sizeof(*b));
+        if (slot < 0 || !b || bot_init(b, g->w * g->h) != 0) {
+            free(b);
+            arena_destroy(a);
+            return NULL;
+        }
+        a->bots[slot] = b;
+    }
+
+    if (game_reset(g, mono_ns()) != 0) {
+        arena_destroy(a);
+        return NULL;
+    }
+    return a;
+}
+
+void arena_destroy(arena_t *a) {
+    if (!a) return;
+    for (int i = 0; i < MAX_SNAKES; i++) {
+        if (!a->bots[i]) continue;
+        bot_free(a->bots[i]);
+        free(a->bots[i]);
+    }
+    game_free(&a->game);
+    free(a->out);
+    pthread_mutex_destroy(&a->lock);
+    pthread_mutex_destroy(&a->flush_lock);
+    free(a);
+}
+
+int arena_join(arena_t *a, session_t *s) {
+    pthread_mutex_lock(&a->lock);
+    int slot = game_add_snake(&a->game);
+    if (slot >= 0) {
+        a->players[slot] = s;
+        a->humans++;
+        a->focus[slot] = (msg_point_t){(int16_t)(a->game.w / 2), (int16_t)(a->game.h / 2)};
+    }
+    pthread_mutex_unlock(&a->lock);
+    if (slot < 0) return -1;
+
+    s->arena = a;
+    s->slot = slot;
+
+    unsigned char buf[sizeof(msg_hdr_t) + sizeof(msg_joined_t)];
+    msg_hdr_t hdr = msg_hdr(RESP_JOINED, sizeof(msg_joined_t));
+    msg_joined_t j = {a->id, slot};
+    memcpy(buf, &hdr, sizeof(hdr));
+    memcpy(buf + sizeof(hdr), &j, sizeof(j));
+    (void)outq_send(&s->outq, s->fd, buf, sizeof(buf), OUTQ_CTRL);
+    return slot;
+}
+
+int arena_leave(arena_t *a, session_t *s) {
+    pthread_mutex_lock(&a->lock);
+    if (a->players[s->slot] == s) {
+        a->players[s->slot] = NULL;
+        game_remove_snake(&a->game, s->slot);
+        a->humans--;
+    }
+    int left = a->humans;
+    pthread_mutex_unlock(&a->lock);
+
+    // tick mohol s zaradiť na flush ešte pred odchodom, po tomto už nie
+    pthread_mutex_lock(&a->flush_lock);
+    pthread_mutex_unlock(&a->flush_lock);
+
+    s->arena = NULL;
+    s->slot = -1;
+    return left;
+}
+
+static unsigned char *out_reserve(arena_t *a, size_t n) {
+    if (n > a->out_cap) {
+        unsigned char *p = (unsigned char *)realloc(a->out, n);
+        if (!p) return NULL;
+        a->out = p;
+        a->out_cap = n;
+    }
+    return a->out;
+}
+
+// Hlavička, záznamy hadov vo výreze hráča v slote a ich body; volá sa
+// pod lock. Výrez je CMD_SET_VIEW hráča, inak ARENA_VIEW, okolo hlavy.
+static size_t encode_view(arena_t *a, int slot) {
+    const game_t *g = &a->game;
+    const session_t *s = a->players[slot];
+    const snake_t *me = &g->snakes[slot];
+    if (me->alive && me->len > 0) a->focus[slot] = game_snake_get(g, slot, 0);
+
+    msg_arena_t m = {
+        .seq = a->seq,
+        .w = g->w,
+        .h = g->h,
+        .fruit_x = g->fruit_x,
+        .fruit_y = g->fruit_y,
+        .elapsed_s = game_elapsed_s(g),
+    };
+    m.view = game_view(g, a->focus[slot].x, a->focus[slot].y,
+                       s->enc.view_w > 0 ? s->enc.view_w : ARENA_VIEW, s->enc.view_h > 0 ? s->enc.view_h : ARENA_VIEW);
+    int64_t view_cells = (int64_t)m.view.w * m.view.h;
+
+    // horný odhad: všetky hady, každý najviac celý výrez a jeden bod
+    // navyše, game_snake_clip zapíše aj bod za posledným vo výreze
+    int used = 0;
+    size_t npoints = 0;
+    for (int i = 0; i < g->nsnakes; i++) {
+        if (!g->snakes[i].used) continue;
+        used++;
+        npoints += (size_t)(g->snakes[i].len < view_cells + 1 ? g->snakes[i].len : view_cells + 1);
+    }
+
+    // body sa píšu za miesto pre všetky záznamy, nakoniec sa prisunú
+    size_t top = sizeof(msg_hdr_t) + sizeof(msg_arena_t);
+    size_t room = top + (size_t)used * sizeof(msg_arena_snake_t);
+    unsigned char *p = out_reserve(a, room + npoints * sizeof(msg_point_t));
+    if (!p) return 0;
+    msg_point_t *pts = (msg_point_t *)(void *)(p + room);
+    msg_arena_snake_t e[MAX_SNAKES];
+    size_t n = 0;
+
+    for (int i = 0; i < g->nsnakes; i++) {
+        const snake_t *sn = &g->snakes[i];
+        if (!sn->used) continue;
+        int head;
+        int k = game_snake_clip(g, i, m.view, pts + n, &head);
+        if (k == 0 && i != slot) continue;
+
+        e[m.nsnakes++] = (msg_arena_snake_t){
+            .slot = (int16_t)i,
+            .alive = (uint8_t)sn->alive,
+            .flags = (uint8_t)((a->bots[i] ? ARENA_SNAKE_BOT : 0) | (head ? ARENA_SNAKE_HEAD : 0)),
+            .score = sn->score,
+            .len = sn->len,
+            .npoints = k,
+        };
+        n += (size_t)k;
+    }
+
+    size_t entries = (size_t)m.nsnakes * sizeof(msg_arena_snake_t);
+    msg_hdr_t hdr = msg_hdr(RESP_ARENA, (uint32_t)(top - sizeof(msg_hdr_t) + entries + n * sizeof(msg_point_t)));
+    memcpy(p, &hdr, sizeof(hdr));
+    memcpy(p + sizeof(hdr), &m, sizeof(m));
+    memcpy(p + top, e, entries);
+    memmove(p + top + entries, pts, n * sizeof(msg_point_t));
+    return top + entries + n * sizeof(msg_point_t);
+}
+
+// príkazy hráča v slote; pauza a tempo patria celej aréne, tie sa ignorujú
+static void drain_player(arena_t *a, session_t *s, int slot) {
+    msg_cmd_t cmd;
+    while (cmd_ring_pop(&s->cmds, &cmd)) {
+        if (cmd.cmd == CMD_DIR) game_queue_turn(&a->game, slot, (dir_t)cmd.arg);
+        else if (cmd.cmd == CMD_RESTART) (void)game_respawn(&a->game, slot);
+        else if (cmd.cmd == CMD_SET_VIEW) session_set_view(s, cmd.arg);
+    }
+}
+
+static void arena_tick(tick_node_t *n) {
+    arena_t *a = TNODE_OWNER(n, arena_t, node);
+    game_t *g = &a->game;
+    int64_t now = n->clock_ns;
+
+    pthread_mutex_lock(&a->lock);
+
+    if (g->gameover) (void)game_reset(g, now); // plná doska, nové kolo
+
+    for (int i = 0; i < g->nsnakes; i++) {
+        if (a->players[i]) {
+            drain_player(a, a->players[i], i);
+        } else if (a->bots[i]) {
+            const snake_t *sn = &g->snakes[i];
+            if (!sn->alive) {
+                (void)game_respawn(g, i);
+                continue;
+            }
+            dir_t d = bot_think(a->bots[i], g, i);
+            if (d != sn->dir) game_queue_turn(g, i, d);
+        }
+    }
+
+    game_tick(g, now);
+
+    // pod lock len kódovanie a zaradenie do front, bez write()
+    session_t *flush[MAX_SNAKES];
+    int nflush = 0;
+    a->seq++;
+    for (int i = 0; i < g->nsnakes; i++) {
+        session_t *s = a->players[i];
+        if (!s) continue;
+        size_t len = encode_view(a, i);
+        if (len > 0 && outq_send(&s->outq, -1, a->out, len, OUTQ_KEY) == 0) flush[nflush++] = s;
+    }
+
+    pthread_mutex_lock(&a->flush_lock);
+    pthread_mutex_unlock(&a->lock);
+    for (int k = 0; k < nflush; k++) (void)outq_flush(&flush[k]->outq, flush[k]->fd);
+    pthread_mutex_unlock(&a->flush_lock);
+}
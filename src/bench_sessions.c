@@ -0,0 +1,163 @@
+// Koľko súbežných 60x40 hier zvládne jedno jadro pri ticku 120 ms.
+//
+// Každé kolo tickne všetky session (krok hry + snapshot do /dev/null).
+// Kolo, ktoré trvá dlhšie ako TICK_MS, je zmeškaný deadline.
+//
+// S -t N sa namiesto toho spustí skutočný tick scheduler s N workermi
+// a vypíše sa oneskorenie tickov po shardoch.
+
+#define _DEFAULT_SOURCE
+
+#include "session.h"
+#include "tick_sched.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_W 60
+#define BENCH_H 40
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static int null_fd = -1;
+
+static session_t *make_session(int id) {
+    session_t *s = session_create(id, null_fd);
+    if (!s) { perror("calloc"); exit(1); }
+
+    msg_cmd_t cfg[] = {
+        {CMD_SET_MODE, MODE_STANDARD},
+        {CMD_SET_WORLD, WORLD_WRAP},
+        {CMD_SET_SIZE, (BENCH_W << 16) | BENCH_H},
+    };
+    for (size_t i = 0; i < sizeof(cfg) / sizeof(cfg[0]); i++) (void)session_on_cmd(s, &cfg[i]);
+    return s;
+}
+
+static void drive(session_t *s) {
+    game_t *g = &s->game;
+    if (g->gameover) { (void)game_reset(g, mono_ns()); return; }
+    if (rand() % 8 == 0) game_queue_turn(g, 0, (dir_t)(1 + rand() % 4));
+}
+
+typedef struct {
+    double avg_ms, max_ms;
+    int misses;
+} result_t;
+
+static result_t run(int n, int rounds) {
+    session_t **ss = (session_t **)calloc((size_t)n, sizeof(*ss));
+    if (!ss) { perror("calloc"); exit(1); }
+    for (int i = 0; i < n; i++) ss[i] = make_session(i + 1);
+
+    result_t r = {0, 0, 0};
+    for (int k = 0; k < rounds; k++) {
+        double t0 = now_ms();
+        for (int i = 0; i < n; i++) {
+            drive(ss[i]);
+            session_tick(ss[i]);
+        }
+        double dt = now_ms() - t0;
+        r.avg_ms += dt;
+        if (dt > r.max_ms) r.max_ms = dt;
+        if (dt > TICK_MS) r.misses++;
+    }
+    r.avg_ms /= rounds;
+
+    for (int i = 0; i < n; i++) {
+        ss[i]->fd = -1; // shared /dev/null
+        session_destroy(ss[i]);
+    }
+    free(ss);
+    return r;
+}
+
+static void run_sched(int threads, int n, int seconds) {
+    tick_sched_t ts;
+    if (tsched_start(&ts, threads) != 0) { perror("tsched_start"); exit(1); }
+
+    session_t **ss = (session_t **)calloc((size_t)n, sizeof(*ss));
+    if (!ss) { perror("calloc"); exit(1); }
+    for (int i = 0; i < n; i++) {
+        ss[i] = make_session(i + 1);
+        tsched_add(&ts, &ss[i]->node);
+    }
+
+    sleep((unsigned)seconds);
+
+    printf("%d sessions, %d worker(s), %d s\n", n, threads, seconds);
+    printf("%5s %8s %10s %8s %8s %12s %12s\n", "shard", "sessions", "ticks", "late", "stolen", "lag avg ms", "lag max ms");
+    for (int i = 0; i < ts.nshards; i++) {
+        shard_stats_t st;
+        tsched_stats(&ts, i, &st, 0);
+        printf("%5d %8d %10llu %8llu %8llu %12.3f %12.3f\n", i, st.sessions,
+               (unsigned long long)st.ticks, (unsigned long long)st.late,
+               (unsigned long long)st.stolen, st.lag_avg_ns / 1e6, st.lag_max_ns / 1e6);
+    }
+
+    tsched_stop(&ts);
+    for (int i = 0; i < n; i++) {
+        ss[i]->fd = -1;
+        session_destroy(ss[i]);
+    }
+    free(ss);
+}
+
+int main(int argc, char **argv) {
+    int rounds = 50, threads = 0, n = 10000, seconds = 5;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:t:n:d:")) != -1) {
+        if (opt == 'r') rounds = atoi(optarg);
+        else if (opt == 't') threads = atoi(optarg);
+        else if (opt == 'n') n = atoi(optarg);
+        else if (opt == 'd') seconds = atoi(optarg);
+        else {
+            fprintf(stderr, "usage: %s [-r rounds] | -t threads [-n sessions] [-d seconds]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (rounds <= 0) rounds = 50;
+    srand(1);
+
+    null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd < 0) { perror("open /dev/null"); return 1; }
+
+    if (threads > 0) {
+        run_sched(threads, n, seconds);
+        close(null_fd);
+        return 0;
+    }
+
+    printf("%dx%d wrap, tick %d ms, %d rounds per step\n", BENCH_W, BENCH_H, TICK_MS, rounds);
+    printf("%8s %10s %10s %7s\n", "sessions", "avg ms", "max ms", "misses");
+
+    // zdvojovanie, kým kolo nestihne deadline, potom bisekcia
+    int best = 0, fail = 0;
+    for (int n = 64; n <= (1 << 18); n *= 2) {
+        result_t r = run(n, rounds);
+        printf("%8d %10.3f %10.3f %7d\n", n, r.avg_ms, r.max_ms, r.misses);
+        fflush(stdout);
+        if (r.misses > 0) { fail = n; break; }
+        best = n;
+    }
+    while (fail && fail - best > best / 16) {
+        int n = best + (fail - best) / 2;
+        result_t r = run(n, rounds);
+        printf("%8d %10.3f %10.3f %7d\n", n, r.avg_ms, r.max_ms, r.misses);
+        fflush(stdout);
+        if (r.misses > 0) fail = n;
+        else best = n;
+    }
+
+    printf("max sessions per core without a missed deadline: ~%d\n", best);
+    close(null_fd);
+    return 0;
+}
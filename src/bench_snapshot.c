@@ -0,0 +1,173 @@
+// Počet write() syscallov a bajtov na jeden snapshot: pôvodné posielanie
+// po jednotlivých poliach a bodoch, jeden zakódovaný buffer, delta
+// frames (s keyframe každých KEYFRAME_TICKS) a keyframe orezaný na
+// výrez malého terminálu (CMD_SET_VIEW VIEW_COLS x VIEW_ROWS). Na konci
+// kontrola, že BYE prejde aj plnou frontou klienta, ktorý nestíha.
+//
+// Linkuje sa s -Wl,--wrap=write, takže sa počíta každé volanie write().
+
+#define _DEFAULT_SOURCE
+
+#include "ipc.h"
+#include "session.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_W 60
+#define BENCH_H 40
+#define ROUNDS 2000
+#define VIEW_COLS 20
+#define VIEW_ROWS 10
+
+static unsigned long write_calls;
+static unsigned long write_bytes;
+
+ssize_t __real_write(int fd, const void *buf, size_t n);
+ssize_t __wrap_write(int fd, const void *buf, size_t n);
+
+ssize_t __wrap_write(int fd, const void *buf, size_t n) {
+    ssize_t r = __real_write(fd, buf, n);
+    write_calls++;
+    if (r > 0) write_bytes += (unsigned long)r;
+    return r;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// had dĺžky len ako had po riadkoch, hlava v strede ring bufferu
+static void make_snake(game_t *g, int len) {
+    game_init(g);
+    g->w = BENCH_W;
+    g->h = BENCH_H;
+    (void)game_reset(g, 0);
+
+    snake_t *sn = &g->snakes[0];
+    free(sn->buf);
+    sn->cap = BENCH_W * BENCH_H;
+    sn->buf = (msg_point_t *)malloc((size_t)sn->cap * sizeof(msg_point_t));
+    if (!sn->buf) { perror("malloc"); exit(1); }
+    sn->len = len;
+    sn->head_idx = sn->cap - len / 2;
+    for (int i = 0; i < len; i++) {
+        int y = i / BENCH_W;
+        int x = (y % 2 == 0) ? i % BENCH_W : BENCH_W - 1 - i % BENCH_W;
+        sn->buf[(sn->head_idx + i) % sn->cap] = (msg_point_t){(int16_t)x, (int16_t)y};
+    }
+}
+
+// pôvodný send_snapshot_locked: hlavička, snapshot a každý bod zvlášť
+static void legacy_send(session_t *s) {
+    const game_t *g = &s->game;
+    msg_snapshot_t m;
+    memset(&m, 0, sizeof(m));
+    m.w = g->w;
+    m.h = g->h;
+    m.snake_len = g->snakes[0].len;
+    msg_hdr_t hdr = msg_hdr(RESP_SNAPSHOT, (uint32_t)(sizeof(m) + (size_t)m.snake_len * sizeof(msg_point_t)));
+
+    (void)ipc_send_all(s->fd, &hdr, sizeof(hdr));
+    (void)ipc_send_all(s->fd, &m, sizeof(m));
+    for (int i = 0; i < g->snakes[0].len; i++) {
+        msg_point_t p = game_snake_get(g, 0, i);
+        (void)ipc_send_all(s->fd, &p, sizeof(p));
+    }
+}
+
+typedef struct {
+    double calls, bytes, ns;
+} result_t;
+
+static result_t measure(session_t *s, int batched, int delta, int32_t view) {
+    s->enc.delta_version = delta ? DELTA_VERSION : 0;
+    session_set_view(s, view);
+    write_calls = write_bytes = 0;
+    double t0 = now_ns();
+    for (int k = 0; k < ROUNDS; k++) {
+        if (batched) session_send_frame(s);
+        else legacy_send(s);
+    }
+    double dt = now_ns() - t0;
+    result_t r = {(double)write_calls / ROUNDS, (double)write_bytes / ROUNDS, dt / ROUNDS};
+    return r;
+}
+
+// Klient nečíta: fronta sa zaplní snapshotmi, BYE ich musí vytlačiť
+// a prísť ako posledný, zahodená delta aj keyframe musia nastaviť
+// resync. Fronta plná samých riadiacich správ ďalšiu nezahodí potichu,
+// outq_send vráti -1.
+static int check_full_queue(void) {
+    int p[2];
+    if (pipe(p) != 0) { perror("pipe"); return -1; }
+
+    outq_t q;
+    outq_init(&q);
+    msg_hdr_t joined = msg_hdr(RESP_JOINED, 0);
+    msg_hdr_t key = msg_hdr(RESP_SNAPSHOT, 0);
+    msg_hdr_t delta = msg_hdr(RESP_DELTA, 0);
+    msg_hdr_t bye = msg_hdr(RESP_BYE, 0);
+
+    (void)outq_send(&q, -1, &joined, sizeof(joined), OUTQ_CTRL);
+    (void)outq_send(&q, -1, &key, sizeof(key), OUTQ_KEY);
+    for (int i = 0; i < 2 * OUTQ_MAX; i++) (void)outq_send(&q, -1, &delta, sizeof(delta), OUTQ_DELTA);
+    int resync = atomic_exchange(&q.resync, 0);
+    int queued = outq_send(&q, -1, &bye, sizeof(bye), OUTQ_CTRL) == 0;
+    int flushed = outq_flush(&q, p[1]) == 0;
+    close(p[1]);
+
+    msg_hdr_t got[OUTQ_MAX];
+    ssize_t r = read(p[0], got, sizeof(got));
+    close(p[0]);
+    int n = (r > 0) ? (int)((size_t)r / sizeof(msg_hdr_t)) : 0;
+    int delivered = queued && flushed && n == 2 && got[0].type == RESP_JOINED && got[n - 1].type == RESP_BYE;
+
+    atomic_store(&q.resync, 0);
+    for (int i = 0; i < OUTQ_MAX; i++) (void)outq_send(&q, -1, &joined, sizeof(joined), OUTQ_CTRL);
+    (void)outq_send(&q, -1, &key, sizeof(key), OUTQ_KEY);
+    resync = resync && atomic_exchange(&q.resync, 0);
+    int refused = outq_send(&q, -1, &bye, sizeof(bye), OUTQ_CTRL) == -1;
+    outq_free(&q);
+
+    printf("full queue: BYE delivered %s, resync after drop %s, queue full of CTRL refused %s\n",
+           delivered ? "yes" : "NO", resync ? "yes" : "NO", refused ? "yes" : "NO");
+    return (delivered && resync && refused) ? 0 : -1;
+}
+
+int main(void) {
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd < 0) { perror("open /dev/null"); return 1; }
+
+    static const int lens[] = {3, 100, 500, 1000, 2000, BENCH_W * BENCH_H};
+
+    printf("snapshot per tick, %dx%d board, %d rounds\n", BENCH_W, BENCH_H, ROUNDS);
+    printf("%6s | %10s %10s %10s | %10s %10s %10s | %11s %10s | %10s %10s\n",
+           "len", "old calls", "old bytes", "old ns", "new calls", "new bytes", "new ns",
+           "delta bytes", "delta ns", "view bytes", "view ns");
+
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        session_t *s = session_create(1, fd);
+        if (!s) { perror("calloc"); return 1; }
+        make_snake(&s->game, lens[i]);
+
+        result_t a = measure(s, 0, 0, 0);
+        result_t b = measure(s, 1, 0, 0);
+        result_t c = measure(s, 1, 1, 0);
+        result_t d = measure(s, 1, 0, (VIEW_COLS << 16) | VIEW_ROWS);
+        printf("%6d | %10.0f %10.0f %10.0f | %10.0f %10.0f %10.0f | %11.0f %10.0f | %10.0f %10.0f\n",
+               lens[i], a.calls, a.bytes, a.ns, b.calls, b.bytes, b.ns, c.bytes, c.ns, d.bytes, d.ns);
+
+        s->fd = -1;
+        session_destroy(s);
+    }
+
+    close(fd);
+    return check_full_queue() == 0 ? 0 : 1;
+}
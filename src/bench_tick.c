@@ -0,0 +1,147 @@
+// Priepustnosť samotnej simulácie: milióny tickov game_tick bez socketov
+// a bez plánovača, s virtuálnymi hodinami a pevným seedom. Pre každú
+// dosku vypíše ns/tick, počet alokácií a checksum (rovnaký seed musí
+// dať rovnaký checksum). S -b hrá bot (bot_think v každom ticku)
+// namiesto náhodných vstupov.
+//
+// Linkuje sa s -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc.
+
+#define _DEFAULT_SOURCE
+
+#include "bot.h"
+#include "game.h"
+#include "map.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_TICKS 2000000
+#define VIRTUAL_TICK_NS 120000000LL
+
+static unsigned long allocs;
+
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t n, size_t sz);
+void *__real_realloc(void *p, size_t n);
+void *__wrap_malloc(size_t n);
+void *__wrap_calloc(size_t n, size_t sz);
+void *__wrap_realloc(void *p, size_t n);
+
+void *__wrap_malloc(size_t n) { allocs++; return __real_malloc(n); }
+void *__wrap_calloc(size_t n, size_t sz) { allocs++; return __real_calloc(n, sz); }
+void *__wrap_realloc(void *p, size_t n) { allocs++; return __real_realloc(p, n); }
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// vstupy hráča z vlastného xorshift, nezávisle od rng hry
+static uint32_t input_rng = 12345;
+
+static uint32_t next_input(void) {
+    input_rng ^= input_rng << 13;
+    input_rng ^= input_rng >> 17;
+    input_rng ^= input_rng << 5;
+    return input_rng;
+}
+
+typedef struct {
+    const char *name;
+    int w, h;
+    world_type_t world;
+} board_t;
+
+static map_catalog_t maps;
+
+static int run(const board_t *b, long ticks, int use_bot) {
+    game_t g;
+    game_init(&g);
+    game_seed(&g, 42);
+    g.w = b->w;
+    g.h = b->h;
+    g.world_type = b->world;
+    if (b->world == WORLD_OBSTACLES) {
+        const map_t *m = map_catalog_get(&maps, 1);
+        if (!m) { fprintf(stderr, "no map in %s\n", MAPS_FILE); return -1; }
+        g.w = m->obst.w;
+        g.h = m->obst.h;
+        (void)game_set_obstacles(&g, &m->obst);
+    }
+
+    input_rng = 12345;
+    int64_t clock = 0;
+    if (game_reset(&g, clock) != 0) { perror("game_reset"); return -1; }
+
+    bot_t bot;
+    if (use_bot && bot_init(&bot, g.w * g.h) != 0) { perror("bot_init"); return -1; }
+
+    unsigned long allocs0 = allocs;
+    long resets = 0;
+    long score_sum = 0;
+    uint64_t checksum = 0;
+
+    double t0 = now_ns();
+    for (long i = 0; i < ticks; i++) {
+        clock += VIRTUAL_TICK_NS;
+        if (g.gameover) {
+            checksum = checksum * 31 + (uint64_t)g.snakes[0].score;
+            score_sum += g.snakes[0].score;
+            (void)game_reset(&g, clock);
+            resets++;
+            continue;
+        }
+        if (use_bot) {
+            dir_t d = bot_think(&bot, &g, 0);
+            if (d != g.snakes[0].dir) game_queue_turn(&g, 0, d);
+        } else if (next_input() % 8 == 0) {
+            game_queue_turn(&g, 0, (dir_t)(1 + next_input() % 4));
+        }
+        game_tick(&g, clock);
+    }
+    double dt = now_ns() - t0;
+    checksum = checksum * 31 + g.snakes[0].pushes;
+
+    printf("%-10s %5dx%-3d | %8.1f | %7lu | %7ld | %10.1f | %016llx\n",
+           b->name, g.w, g.h, dt / (double)ticks, allocs - allocs0, resets,
+           resets ? (double)score_sum / (double)resets : (double)g.snakes[0].score, (unsigned long long)checksum);
+
+    if (use_bot) bot_free(&bot);
+    game_free(&g);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    long ticks = DEFAULT_TICKS;
+    int use_bot = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:b")) != -1) {
+        if (opt == 'n') ticks = atol(optarg);
+        else if (opt == 'b') use_bot = 1;
+        else {
+            fprintf(stderr, "usage: %s [-n ticks] [-b]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (ticks <= 0) ticks = DEFAULT_TICKS;
+    (void)map_catalog_load(&maps, MAPS_FILE);
+
+    static const board_t boards[] = {
+        {"wrap", MIN_W, MIN_H, WORLD_WRAP},
+        {"wrap", 20, 15, WORLD_WRAP},
+        {"wrap", 40, 30, WORLD_WRAP},
+        {"wrap", MAX_W, MAX_H, WORLD_WRAP},
+        {"obstacles", 0, 0, WORLD_OBSTACLES}, // size of map 1 from MAPS_FILE
+    };
+
+    printf("game_tick throughput, %ld ticks per board, seed 42, %s\n", ticks, use_bot ? "bot" : "random input");
+    printf("%-10s %9s | %8s | %7s | %7s | %10s | %16s\n",
+           "world", "size", "ns/tick", "allocs", "resets", "score/game", "checksum");
+    for (size_t i = 0; i < sizeof(boards) / sizeof(boards[0]); i++) {
+        if (run(&boards[i], ticks, use_bot) != 0) return 1;
+    }
+    return 0;
+}
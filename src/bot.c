@@ -0,0 +1,212 @@
+#include "bot.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int bot_init(bot_t *b, int cells) {
+    memset(b, 0, sizeof(*b));
+    int nodes = cells < BOT_NODES ? cells : BOT_NODES;
+    if (nodes < 1) nodes = 1;
+    int size = 1;
+    while (size < 2 * nodes) size <<= 1;
+
+    b->frontier = (int32_t *)malloc((size_t)nodes * sizeof(int32_t));
+    b->path = (uint8_t *)malloc((size_t)nodes);
+    b->keys = (int32_t *)malloc((size_t)size * sizeof(int32_t));
+    b->seen = (uint32_t *)calloc((size_t)size, sizeof(uint32_t));
+    b->came_from = (uint8_t *)malloc((size_t)size);
+    if (!b->frontier || !b->path || !b->keys || !b->seen || !b->came_from) {
+        bot_free(b);
+        return -1;
+    }
+    b->nodes = nodes;
+    b->hash_mask = size - 1;
+    return 0;
+}
+
+void bot_free(bot_t *b) {
+    free(b->frontier);
+    free(b->path);
+    free(b->keys);
+    free(b->seen);
+    free(b->came_from);
+    memset(b, 0, sizeof(*b));
+}
+
+static dir_t opposite(int d) {
+    if (d == DIR_UP) return DIR_DOWN;
+    if (d == DIR_DOWN) return DIR_UP;
+    if (d == DIR_LEFT) return DIR_RIGHT;
+    return DIR_LEFT;
+}
+
+// sused (x, y) v smere d; 0 mimo dosky
+static int step_to(const game_t *g, int *x, int *y, int d) {
+    int nx = *x, ny = *y;
+    if (d == DIR_UP) ny--;
+    else if (d == DIR_DOWN) ny++;
+    else if (d == DIR_LEFT) nx--;
+    else nx++;
+
+    if (g->world_type == WORLD_WRAP) {
+        if (nx < 0) nx = g->w - 1;
+        else if (nx >= g->w) nx = 0;
+        if (ny < 0) ny = g->h - 1;
+        else if (ny >= g->h) ny = 0;
+    } else if (nx < 0 || nx >= g->w || ny < 0 || ny >= g->h) {
+        return 0;
+    }
+    *x = nx;
+    *y = ny;
+    return 1;
+}
+
+#define PACK(x, y) (((int32_t)(y) << 16) | (int32_t)(x))
+
+// Keď sa doska zmestí do tabuľky, slot je priamo index bunky (direct,
+// nastaví bot_think), inak hash s lineárnym skúšaním.
+static int first_slot(const bot_t *b, int32_t key) {
+    if (b->direct) return (key >> 16) * b->direct + (key & 0xFFFF);
+    return (int)(((uint32_t)key * 0x9E3779B1u) >> 7) & b->hash_mask;
+}
+
+// slot bunky v tabuľke navštívených; -1 ak v tomto hľadaní nebola
+static int visited(const bot_t *b, int32_t key) {
+    int i = first_slot(b, key);
+    while (b->seen[i] == b->gen) {
+        if (b->keys[i] == key) return i;
+        i = (i + 1) & b->hash_mask;
+    }
+    return -1;
+}
+
+static void visit(bot_t *b, int32_t key, int d) {
+    int i = first_slot(b, key);
+    while (b->seen[i] == b->gen) i = (i + 1) & b->hash_mask;
+    b->seen[i] = b->gen;
+    b->keys[i] = key;
+    b->came_from[i] = (uint8_t)d;
+}
+
+// bunka, na ktorú hlava smie v ďalšom ticku vojsť; vlastný chvost
+// sa uvoľní, ak had nerastie
+static int walkable(const snake_t *s, const game_t *g, int x, int y, int32_t tail) {
+    return game_cell(g, x, y) == CELL_FREE || (PACK(x, y) == tail && s->grow_pending == 0);
+}
+
+// vzdialenosť k ovociu, na wrap doske cez okraj
+static int fruit_dist(const game_t *g, int x, int y) {
+    int dx = abs(x - g->fruit_x), dy = abs(y - g->fruit_y);
+    if (g->world_type == WORLD_WRAP) {
+        if (dx > g->w - dx) dx = g->w - dx;
+        if (dy > g->h - dy) dy = g->h - dy;
+    }
+    return dx + dy;
+}
+
+// pokračovanie uloženej cesty, ak ešte platí
+static int follow_path(bot_t *b, const game_t *g, int snake, int32_t fruit, int32_t tail, dir_t *out) {
+    if (b->path_pos >= b->path_len || b->path_fruit != fruit || b->path_epoch != g->epoch) return 0;
+
+    msg_point_t hp = game_snake_get(g, snake, 0);
+    int x = hp.x, y = hp.y;
+    int d = b->path[b->path_pos];
+    if (!step_to(g, &x, &y, d) || !walkable(&g->snakes[snake], g, x, y, tail)) return 0;
+
+    b->path_pos++;
+    *out = (dir_t)d;
+    return 1;
+}
+
+// cesta z (tx, ty) späť po came_from, uloží sa od hlavy
+static dir_t store_path(bot_t *b, const game_t *g, int tx, int ty, int32_t head, int32_t fruit) {
+    int len = 0;
+    int x = tx, y = ty;
+    while (PACK(x, y) != head && len < b->nodes) {
+        int d = b->came_from[visited(b, PACK(x, y))];
+        b->path[len++] = (uint8_t)d;
+        (void)step_to(g, &x, &y, opposite(d));
+    }
+    for (int i = 0; i < len / 2; i++) {
+        uint8_t t = b->path[i];
+        b->path[i] = b->path[len - 1 - i];
+        b->path[len - 1 - i] = t;
+    }
+    b->path_len = len;
+    b->path_pos = 1;
+    b->path_fruit = fruit;
+    b->path_epoch = g->epoch;
+    return (dir_t)b->path[0];
+}
+
+dir_t bot_think(bot_t *b, const game_t *g, int snake) {
+    const snake_t *s = &g->snakes[snake];
+    if (!g->active || g->gameover || !s->alive || s->len == 0 || b->nodes == 0) return s->dir;
+
+    msg_point_t hp = game_snake_get(g, snake, 0);
+    msg_point_t tp = game_snake_get(g, snake, s->len - 1);
+    int32_t head = PACK(hp.x, hp.y);
+    int32_t tail = PACK(tp.x, tp.y);
+    int32_t fruit = (g->fruit_x >= 0) ? PACK(g->fruit_x, g->fruit_y) : -1;
+
+    dir_t d;
+    if (fruit >= 0 && follow_path(b, g, snake, fruit, tail, &d)) return d;
+    b->path_len = 0;
+
+    b->direct = (g->w * g->h <= b->hash_mask + 1) ? g->w : 0;
+    if (++b->gen == 0) {
+        memset(b->seen, 0, (size_t)(b->hash_mask + 1) * sizeof(uint32_t));
+        b->gen = 1;
+    }
+
+    // BFS; came_from je smer, ktorým sa do bunky vošlo
+    dir_t to_tail = 0, any = 0;
+    int qh = 0, qt = 0;
+    int truncated = 0;
+    int32_t best = -1;
+    int best_dist = fruit >= 0 ? fruit_dist(g, hp.x, hp.y) : 0;
+    visit(b, head, 0);
+    b->frontier[qt++] = head;
+
+    while (qh < qt) {
+        int32_t p = b->frontier[qh++];
+        int cx = p & 0xFFFF, cy = p >> 16;
+        int from_head = (qh == 1);
+        for (int dir = DIR_UP; dir <= DIR_RIGHT; dir++) {
+            int x = cx, y = cy;
+            if (!step_to(g, &x, &y, dir)) continue;
+            int32_t c = PACK(x, y);
+            if (visited(b, c) >= 0) continue;
+            if (!walkable(s, g, x, y, tail)) continue;
+            if (qt == b->nodes) { truncated = 1; continue; }
+            visit(b, c, dir);
+
+            if (c == fruit) return store_path(b, g, x, y, head, fruit);
+            if (from_head && !any) any = (dir_t)dir;
+            if (c == tail) {
+                // za chvost sa ďalej nejde; prvý krok zistíme spätne
+                if (!to_tail) {
+                    int bx = x, by = y;
+                    int step = dir;
+                    while (PACK(bx, by) != head) {
+                        step = b->came_from[visited(b, PACK(bx, by))];
+                        (void)step_to(g, &bx, &by, opposite(step));
+                    }
+                    to_tail = (dir_t)step;
+                }
+                continue;
+            }
+            if (fruit >= 0) {
+                int dist = fruit_dist(g, x, y);
+                if (dist < best_dist) { best_dist = dist; best = c; }
+            }
+            b->frontier[qt++] = c;
+        }
+    }
+
+    // ovocie je za hranicou hľadania: k najbližšej navštívenej bunke
+    if (truncated && best >= 0) return store_path(b, g, best & 0xFFFF, best >> 16, head, fruit);
+    if (to_tail) return to_tail;
+    if (any) return any;
+    return s->dir;
+}
@@ -1,9 +1,11 @@
 #define _DEFAULT_SOURCE
 
 #include "ipc.h"
+#include "map.h"
 #include "protocol.h"
 
 #include <pthread.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <signal.h>
@@ -12,30 +14,89 @@
 #include <ncurses.h>
 #include <stdint.h>
 #include <errno.h>
+#include <fcntl.h>
 
+#include <poll.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
-#define MAX_POINTS 4096
-#define OB_W 45
-#define OB_H 30
-#define OB_FILE "assets/obstacles_45x30.txt"
+#define MAP_CACHE_DIR "pos-snake/maps" // maps from RESP_MAP, by hash
+
+#define MENU_ARENA 3
+#define MENU_WATCH 4
+#define ARENA_NUMBER 1
+#define MAX_ARENA_SNAKES 64   // sanity limit for RESP_ARENA
+#define MAX_ARENA_SIDE 4096   // MAX_WORLD on the server
+#define MIN_VIEW 20           // smallest arena window worth drawing
+
+// Hotový frame pre renderer: kópia hadovho ringu s rovnakými indexmi,
+// uložená dvakrát za sebou (pts[i] == pts[i + cap]), takže body od hlavy
+// sú vždy súvislé: pts + head, snap.npoints bodov, bez limitu dĺžky.
+typedef struct {
+    msg_snapshot_t snap;
+    msg_point_t *pts;     // 2 * cap
+    int cap;              // ring_cap it mirrors
+    int head;
+    uint32_t gen;         // last publication written into it
+    int valid;            // filled at least once
+} frame_buf_t;
+
+// Trojitý buffer recv_thread -> renderer bez zámku: recv_thread dobehne
+// back a vymení ho s middle, renderer si middle vymení so svojím front
+// a kreslí z neho, kým nepríde novší. Nikto nečaká.
+#define FRAMES_FRESH 4    // middle holds a frame the renderer has not taken
+#define FRAMES_LOG 4      // head moves kept for a back buffer that fell behind
+
+typedef struct {
+    frame_buf_t buf[3];
+    int back;             // recv_thread only
+    atomic_int middle;    // index | FRAMES_FRESH
+    int front;            // renderer only
+
+    // len recv_thread: kam sa posunula hlava pri posledných publikovaniach
+    uint32_t gen;         // publications so far
+    uint32_t key_gen;     // last keyframe, older buffers copy the whole ring
+    struct { int idx; msg_point_t p; } log[FRAMES_LOG]; // idx -1: head did not move
+} frames_t;
 
 typedef struct {
     int fd;
     volatile sig_atomic_t running;
+    int wake_fd;          // eventfd, recv_thread bumps it when there is something new to draw or send
 
     pthread_mutex_t lock;
+
+    // zrkadlo hadovho ring bufferu zo servera, hlava na ring[ring_head];
+    // snap, have_last a ring patria len recv_thread
     msg_snapshot_t snap;
-    msg_point_t pts[MAX_POINTS];
     int have_last;
+    msg_point_t *ring;
+    int ring_cap, ring_head, ring_len;
+    volatile sig_atomic_t want_keyframe;
+    frames_t frames;      // what the renderer draws
+
+    // aréna: vlastný had a posledný RESP_ARENA (msg_arena_t, hady, body
+    // v jednom bloku), hlavná slučka si ho odoberie pod zámkom
+    int slot;
+    unsigned char *arena_frame;
 
     int best_score;
 
-    world_type_t world_type;
-    int w, h;
-    uint8_t *obst;
+    int watch;            // session being watched, 0 = own game
+    // mapa z cache alebo z RESP_MAP, pod zámkom; NULL kým nepríde
+    map_t *map;
+    msg_map_t map_info;
+    volatile sig_atomic_t want_map;
+
+    // RESP_SHM: keyframy zo zdieľanej pamäte, socket nesie už len zvyšok
+    int passed_fd;        // fd from the last SCM_RIGHTS, -1 = none
+    ipc_shm_t *shm;       // under lock, NULL = frames come on the socket
+    size_t shm_size;
+    pthread_t shm_waiter;
+    int shm_started;
 } client_state_t;
 
 static void cleanup_curses(void) { endwin(); }
@@ -52,7 +113,8 @@ enum {
     CP_SNAKE_BODY  = 3,
     CP_FRUIT  = 4,
     CP_TEXT   = 5,
-    CP_OBST   = 6
+    CP_OBST   = 6,
+    CP_OTHER  = 7
 };
 
 static void term_size(int *cols, int *rows) {
@@ -83,28 +145,68 @@ static void save_best_score(int v) {
     fclose(f);
 }
 
-static int load_obstacles_client(client_state_t *st, const char *path) {
-    if (st->w <= 0 || st->h <= 0) return -1;
-    size_t n = (size_t)st->w * (size_t)st->h;
-    st->obst = (uint8_t *)calloc(n, 1);
-    if (!st->obst) return -1;
+static int obst_at_client(const obst_map_t *m, int x, int y) {
+    if (x < 0 || x >= m->w || y < 0 || y >= m->h) return 1;
+    return obst_cell(m, x, y);
+}
 
-    FILE *f = fopen(path, "r");
-    if (!f) return -1;
+/* ===================== cache máp ===================== */
+
+// $XDG_CACHE_HOME/MAP_CACHE_DIR, inak ~/.cache/MAP_CACHE_DIR
+static int map_cache_dir(char *out, size_t n) {
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    int r;
+    if (xdg && *xdg) r = snprintf(out, n, "%s/" MAP_CACHE_DIR, xdg);
+    else if (home && *home) r = snprintf(out, n, "%s/.cache/" MAP_CACHE_DIR, home);
+    else return -1;
+    return (r > 0 && (size_t)r < n) ? 0 : -1;
+}
+
+static int map_cache_path(uint64_t hash, char *out, size_t n) {
+    char dir[400];
+    if (map_cache_dir(dir, sizeof(dir)) != 0) return -1;
+    int r = snprintf(out, n, "%s/%016llx" MAP_EXT, dir, (unsigned long long)hash);
+    return (r > 0 && (size_t)r < n) ? 0 : -1;
+}
+
+// mapa s daným hashom z cache, NULL ak tam nie je
+static map_t *map_cache_open(uint64_t hash) {
+    char path[512];
+    if (map_cache_path(hash, path, sizeof(path)) != 0) return NULL;
+    map_t *m = map_open(path);
+    if (m && m->hash != hash) { map_free(m); return NULL; }
+    return m;
+}
 
-    char line[256];
-    for (int y = 0; y < st->h; y++) {
-        if (!fgets(line, (int)sizeof(line), f)) { fclose(f); return -1; }
-        for (int x = 0; x < st->w; x++) st->obst[y * st->w + x] = (line[x] == '#') ? 1 : 0;
+// zapíše cez dočasný súbor, aby iný klient nenamapoval polovičný
+static void map_cache_store(const map_t *m) {
+    char dir[400], path[512], tmp[540];
+    if (map_cache_dir(dir, sizeof(dir)) != 0 || map_cache_path(m->hash, path, sizeof(path)) != 0) return;
+
+    for (char *p = dir + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        (void)mkdir(dir, 0755);
+        *p = '/';
     }
-    fclose(f);
-    return 0;
+    (void)mkdir(dir, 0755);
+
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+    if (map_write(m, tmp) != 0 || rename(tmp, path) != 0) unlink(tmp);
 }
 
-static int obst_at_client(const client_state_t *st, int x, int y) {
-    if (!st->obst) return 0;
-    if (x < 0 || x >= st->w || y < 0 || y >= st->h) return 1;
-    return st->obst[y * st->w + x] ? 1 : 0;
+// payload RESP_MAP; NULL pri poškodenej alebo inej mape (spojenie je
+// v poriadku, hra pôjde bez prekážok)
+static map_t *parse_map(const unsigned char *p, uint32_t len, const msg_map_t *info) {
+    msg_map_t h;
+    if (len < sizeof(h)) return NULL;
+    memcpy(&h, p, sizeof(h));
+    if (h.nspawns < 0 || h.nspawns > MAX_MAP_SPAWNS || h.rle_len < 1) return NULL;
+
+    size_t sp = (size_t)h.nspawns * sizeof(msg_point_t);
+    if (len - sizeof(h) < sp + (size_t)h.rle_len || h.hash != info->hash) return NULL;
+    return map_from_wire(&h, (const msg_point_t *)(const void *)(p + sizeof(h)), p + sizeof(h) + sp);
 }
 
 static void init_curses(void) {
@@ -124,6 +226,7 @@ static void init_curses(void) {
         init_pair(CP_FRUIT, COLOR_RED, -1);
         init_pair(CP_TEXT, COLOR_WHITE, -1);
         init_pair(CP_OBST, COLOR_YELLOW, -1);
+        init_pair(CP_OTHER, COLOR_MAGENTA, -1);
     }
 
     atexit(cleanup_curses);
@@ -131,154 +234,797 @@ static void init_curses(void) {
     signal(SIGTERM, handle_signal);
 }
 
+// Príkazy poskladané za sebou a poslané jedným write(), napr. celý
+// config z menu; server ich rozoberie z jedného read().
+#define CMD_BATCH_MAX 16
+
+typedef struct {
+    unsigned char buf[CMD_BATCH_MAX * CMD_FRAME_SIZE];
+    size_t len;
+} cmd_batch_t;
+
+static void batch_add(cmd_batch_t *b, command_t c, int32_t arg) {
+    if (b->len + CMD_FRAME_SIZE <= sizeof(b->buf)) b->len += ipc_cmd_put(b->buf + b->len, c, arg);
+}
+
+static void batch_send(int fd, cmd_batch_t *b) {
+    (void)ipc_send_all(fd, b->buf, b->len);
+    b->len = 0;
+}
+
 static void send_cmd(int fd, command_t c, int32_t arg) {
-    msg_cmd_t m;
-    m.cmd = (int32_t)c;
-    m.arg = arg;
-    (void)ipc_send_all(fd, &m, sizeof(m));
+    unsigned char buf[CMD_FRAME_SIZE];
+    (void)ipc_send_all(fd, buf, ipc_cmd_put(buf, c, arg));
 }
 
-static void *recv_thread(void *arg) {
+// hracia plocha, ktorú terminál ukáže: bez stavových riadkov a rámu
+static int32_t view_arg(int cols, int rows) {
+    int w = cols - 5, h = rows - 5;
+    if (w < 1) w = 1;
+    if (h < 1) h = 1;
+    return (int32_t)((w << 16) | (h & 0xFFFF));
+}
+
+static void send_view(int fd, int cols, int rows) {
+    send_cmd(fd, CMD_SET_VIEW, view_arg(cols, rows));
+}
+
+static void frames_init(frames_t *f) {
+    memset(f, 0, sizeof(*f));
+    f->back = 0;
+    atomic_init(&f->middle, 1);
+    f->front = 2;
+}
+
+static void frames_free(frames_t *f) {
+    for (int i = 0; i < 3; i++) free(f->buf[i].pts);
+}
+
+// celý živý ring do oboch polovíc b
+static int frames_copy_ring(frame_buf_t *b, const client_state_t *st) {
+    int cap = st->ring_cap;
+    if (b->cap != cap) {
+        msg_point_t *p = (msg_point_t *)realloc(b->pts, 2 * (size_t)cap * sizeof(msg_point_t));
+        if (!p) return -1;
+        b->pts = p;
+        b->cap = cap;
+    }
+    int n = st->ring_len, head = st->ring_head;
+    int first = cap - head < n ? cap - head : n;
+    size_t fb = (size_t)first * sizeof(msg_point_t), rb = (size_t)(n - first) * sizeof(msg_point_t);
+    memcpy(b->pts + head, st->ring + head, fb);
+    memcpy(b->pts + cap + head, st->ring + head, fb);
+    memcpy(b->pts, st->ring, rb);
+    memcpy(b->pts + cap, st->ring, rb);
+    return 0;
+}
+
+// recv_thread: back dobehne zrkadlo a vymení sa s middle. Slot ringu sa
+// mení, len keď naň vojde hlava, a chvost je iba dĺžka, takže po delte
+// sa do back dopíšu len hlavy od jeho posledného publikovania. Celý ring
+// sa kopíruje po keyframe, pri väčšej doske alebo keď back zaostal
+// o viac ako FRAMES_LOG (renderer dlho držal front).
+static int frames_publish(frames_t *f, const client_state_t *st, int keyframe, int moved) {
+    f->gen++;
+    if (keyframe) f->key_gen = f->gen;
+    f->log[f->gen % FRAMES_LOG].idx = moved ? st->ring_head : -1;
+    if (moved) f->log[f->gen % FRAMES_LOG].p = st->ring[st->ring_head];
+
+    frame_buf_t *b = &f->buf[f->back];
+    if (!b->valid || b->cap != st->ring_cap || f->gen - b->gen > f->gen - f->key_gen || f->gen - b->gen > FRAMES_LOG) {
+        if (frames_copy_ring(b, st) != 0) return -1;
+    } else {
+        for (uint32_t g = b->gen + 1; g <= f->gen; g++) {
+            int idx = f->log[g % FRAMES_LOG].idx;
+            if (idx < 0) continue;
+            b->pts[idx] = b->pts[idx + b->cap] = f->log[g % FRAMES_LOG].p;
+        }
+    }
+    b->head = st->ring_head;
+    b->snap = st->snap;
+    b->gen = f->gen;
+    b->valid = 1;
+
+    f->back = atomic_exchange(&f->middle, f->back | FRAMES_FRESH) & 3;
+    return 0;
+}
+
+// renderer: najnovší frame; bez nového zostáva posledný (resize)
+static const frame_buf_t *frames_take(frames_t *f) {
+    if (atomic_load(&f->middle) & FRAMES_FRESH) f->front = atomic_exchange(&f->middle, f->front) & 3;
+    return &f->buf[f->front];
+}
+
+// len recv_thread; -1 ak delta nenadväzuje na posledný frame
+static int apply_delta(client_state_t *st, const msg_delta_t *d) {
+    if (!st->have_last || d->version != DELTA_VERSION) return -1;
+    if (d->seq != st->snap.seq + 1) return -1;
+    if (d->tail_pops > st->ring_len) return -1;
+
+    st->ring_len -= d->tail_pops;
+    if (d->flags & DELTA_HEAD) {
+        if (st->ring_len >= st->ring_cap) return -1;
+        st->ring_head = (st->ring_head == 0) ? st->ring_cap - 1 : st->ring_head - 1;
+        st->ring[st->ring_head] = d->head;
+        st->ring_len++;
+    }
+
+    msg_snapshot_t *s = &st->snap;
+    if (d->flags & DELTA_FRUIT) { s->fruit_x = d->fruit.x; s->fruit_y = d->fruit.y; }
+    if (d->flags & DELTA_SCORE) s->score += d->score_delta;
+    s->paused = d->paused;
+    s->gameover = d->gameover;
+    s->elapsed_s = d->elapsed_s;
+    s->time_left_s = d->time_left_s;
+    s->snake_len = st->ring_len;
+    s->npoints = st->ring_len;
+    s->seq = d->seq;
+    return 0;
+}
+
+static int view_valid(const msg_rect_t *v, int w, int h) {
+    return v->x >= 0 && v->y >= 0 && v->w > 0 && v->h > 0 && v->x + v->w <= w && v->y + v->h <= h;
+}
+
+// payload RESP_ARENA skontrolovaný a skopírovaný do jedného bloku
+// (msg_arena_t, hady, body), ktorý si odoberie hlavná slučka; NULL pri chybe
+static unsigned char *parse_arena_frame(const unsigned char *p, uint32_t len) {
+    msg_arena_t a;
+    if (len < sizeof(a)) return NULL;
+    memcpy(&a, p, sizeof(a));
+    if (a.nsnakes < 0 || a.nsnakes > MAX_ARENA_SNAKES || a.w <= 0 || a.h <= 0 ||
+        a.w > MAX_ARENA_SIDE || a.h > MAX_ARENA_SIDE) return NULL;
+    if (!view_valid(&a.view, a.w, a.h)) return NULL;
+
+    size_t head = sizeof(a) + (size_t)a.nsnakes * sizeof(msg_arena_snake_t);
+    if (len < head) return NULL;
+
+    size_t npts = 0;
+    for (int i = 0; i < a.nsnakes; i++) {
+        msg_arena_snake_t sn;
+        memcpy(&sn, p + sizeof(a) + (size_t)i * sizeof(sn), sizeof(sn));
+        if (sn.npoints < 0 || sn.npoints > a.view.w * a.view.h) return NULL;
+        npts += (size_t)sn.npoints;
+    }
+
+    size_t total = head + npts * sizeof(msg_point_t);
+    if (len < total) return NULL;
+    unsigned char *buf = (unsigned char *)malloc(total);
+    if (buf) memcpy(buf, p, total);
+    return buf;
+}
+
+// zobudí hlavnú slučku (wait_events)
+static void notify(client_state_t *st) {
+    uint64_t one = 1;
+    if (write(st->wake_fd, &one, sizeof(one)) < 0) {}
+}
+
+// Čaká na futexe segmentu a každý nový frame ohlási hlavnej slučke;
+// končí, keď server segment zavrie (session skončila) alebo klient.
+#define SHM_WAIT_MS 500
+
+static void *shm_thread(void *arg) {
     client_state_t *st = (client_state_t *)arg;
+    unsigned seen = 0;
+    while (st->running && !atomic_load(&st->shm->closed)) {
+        unsigned n = atomic_load(&st->shm->frames);
+        if (n != seen) {
+            seen = n;
+            notify(st);
+            continue;
+        }
+        (void)ipc_shm_wait(st->shm, n, SHM_WAIT_MS);
+    }
+    return NULL;
+}
 
-    while (st->running) {
-        msg_resp_t hdr;
-        if (ipc_recv_all(st->fd, &hdr, sizeof(hdr)) != 0) break;
+// Jeden rámec priamo z prijímacieho bufferu; 0 ďalej, -1 koniec spojenia.
+// Neznáme typy sa preskočia, payload dlhší než treba tiež nevadí.
+static int on_frame(client_state_t *st, const msg_hdr_t *h, const unsigned char *p) {
+    if (h->type == RESP_BYE) return -1;
 
-        if (hdr.resp == RESP_BYE) break;
+    if (h->type == RESP_JOINED) {
+        msg_joined_t j;
+        if (h->len < sizeof(j)) return -1;
+        memcpy(&j, p, sizeof(j));
+        st->slot = j.slot;
+        return 0;
+    }
 
-        if (hdr.resp == RESP_SNAPSHOT) {
-            msg_snapshot_t s;
-            if (ipc_recv_all(st->fd, &s, sizeof(s)) != 0) break;
+    if (h->type == RESP_MAP_INFO) {
+        msg_map_t info;
+        if (h->len < sizeof(info)) return -1;
+        memcpy(&info, p, sizeof(info));
+
+        map_t *m = map_cache_open(info.hash);
+        pthread_mutex_lock(&st->lock);
+        st->map_info = info;
+        if (m) st->map = m;
+        pthread_mutex_unlock(&st->lock);
+        if (!m) st->want_map = 1;
+        notify(st);
+        return 0;
+    }
 
-            int n = s.snake_len;
-            if (n < 0) n = 0;
-            if (n > MAX_POINTS) n = MAX_POINTS;
+    if (h->type == RESP_MAP) {
+        map_t *m = parse_map(p, h->len, &st->map_info);
+        if (!m) return 0;
 
-            msg_point_t tmp[MAX_POINTS];
-            for (int i = 0; i < n; i++) {
-                if (ipc_recv_all(st->fd, &tmp[i], sizeof(tmp[i])) != 0) {
-                    st->running = 0;
-                    return NULL;
-                }
-            }
+        map_cache_store(m);
+        pthread_mutex_lock(&st->lock);
+        if (!st->map) { st->map = m; m = NULL; }
+        pthread_mutex_unlock(&st->lock);
+        map_free(m);
+        notify(st);
+        return 0;
+    }
 
-            pthread_mutex_lock(&st->lock);
-            st->snap = s;
-            for (int i = 0; i < n; i++) st->pts[i] = tmp[i];
-            st->have_last = 1;
-            pthread_mutex_unlock(&st->lock);
+    if (h->type == RESP_SHM) {
+        // po RESP_SHM server snapshoty na socket neposiela, bez segmentu koniec
+        size_t size;
+        ipc_shm_t *m = (st->passed_fd >= 0 && !st->shm) ? ipc_shm_map(st->passed_fd, &size) : NULL;
+        if (st->passed_fd >= 0) close(st->passed_fd);
+        st->passed_fd = -1;
+        if (!m) return -1;
+
+        pthread_mutex_lock(&st->lock);
+        st->shm = m;
+        st->shm_size = size;
+        pthread_mutex_unlock(&st->lock);
+        if (pthread_create(&st->shm_waiter, NULL, shm_thread, st) != 0) return -1;
+        st->shm_started = 1;
+        return 0;
+    }
+
+    if (h->type == RESP_ARENA) {
+        unsigned char *frame = parse_arena_frame(p, h->len);
+        if (!frame) return -1;
+
+        // nestihnutý frame sa zahodí, kreslí sa len posledný
+        pthread_mutex_lock(&st->lock);
+        free(st->arena_frame);
+        st->arena_frame = frame;
+        pthread_mutex_unlock(&st->lock);
+        notify(st);
+        return 0;
+    }
+
+    if (h->type == RESP_SNAPSHOT) {
+        msg_snapshot_t s;
+        if (h->len < sizeof(s)) return -1;
+        memcpy(&s, p, sizeof(s));
+
+        if (s.w <= 0 || s.h <= 0 || !view_valid(&s.view, s.w, s.h)) return -1;
+        if (s.npoints < 0 || s.npoints > s.view.w * s.view.h) return -1;
+        int n = s.npoints;
+        if (h->len - sizeof(s) < (size_t)n * sizeof(msg_point_t)) return -1;
+        int cap = s.w * s.h;
+        if (cap < n) cap = n;
+        if (cap < 1) cap = 1;
+
+        // ring sa zväčšuje len pri väčšej doske
+        if (st->ring_cap < cap) {
+            msg_point_t *ring = (msg_point_t *)realloc(st->ring, (size_t)cap * sizeof(msg_point_t));
+            if (!ring) return -1;
+            st->ring = ring;
+            st->ring_cap = cap;
         }
+        memcpy(st->ring, p + sizeof(s), (size_t)n * sizeof(msg_point_t));
+        st->ring_head = 0;
+        st->ring_len = n;
+        st->snap = s;
+        st->have_last = 1;
+        if (frames_publish(&st->frames, st, 1, 0) != 0) return -1;
+        notify(st);
+        return 0;
     }
 
+    if (h->type == RESP_DELTA) {
+        msg_delta_t d;
+        if (h->len < sizeof(d)) return -1;
+        memcpy(&d, p, sizeof(d));
+
+        if (apply_delta(st, &d) == 0) {
+            if (frames_publish(&st->frames, st, 0, (d.flags & DELTA_HEAD) != 0) != 0) return -1;
+            notify(st);
+        } else if (st->have_last) {
+            st->have_last = 0;
+            st->want_keyframe = 1;
+            notify(st);
+        }
+    }
+    return 0;
+}
+
+// Číta po veľkých kusoch a rozoberá všetky celé rámce v bufferi naraz;
+// buffer rastie len kvôli rámcu väčšiemu než on (mapa, veľký keyframe).
+#define RX_CHUNK 65536
+
+static void *recv_thread(void *arg) {
+    client_state_t *st = (client_state_t *)arg;
+    size_t cap = RX_CHUNK, len = 0;
+    unsigned char *rx = (unsigned char *)malloc(cap);
+    st->passed_fd = -1;
+
+    while (rx && st->running) {
+        ssize_t r = ipc_recv_fd(st->fd, rx + len, cap - len, &st->passed_fd);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        len += (size_t)r;
+
+        size_t off = 0, need = 0;
+        int rc = 0;
+        while (rc == 0) {
+            msg_hdr_t h;
+            const unsigned char *p;
+            ssize_t n = ipc_frame_parse(rx + off, len - off, MAX_FRAME_LEN, &h, &p);
+            if (n < 0) rc = -1;
+            if (n == 0 && len - off >= sizeof(h)) need = sizeof(h) + h.len;
+            if (n <= 0) break;
+            rc = on_frame(st, &h, p);
+            off += (size_t)n;
+        }
+        if (rc != 0) break;
+
+        memmove(rx, rx + off, len - off);
+        len -= off;
+        if (need > cap) {
+            unsigned char *bigger = (unsigned char *)realloc(rx, need);
+            if (!bigger) break;
+            rx = bigger;
+            cap = need;
+        }
+    }
+
+    free(rx);
+    if (st->passed_fd >= 0) close(st->passed_fd);
     st->running = 0;
+    notify(st);
     return NULL;
 }
 
-static void draw_border(int top, int left, int w, int h) {
-    (void)w; (void)h;
-    if (has_colors()) attron(COLOR_PAIR(CP_BORDER));
+/* ===================== obrazovka ===================== */
+
+// Tieňová kópia terminálu: cur je to, čo na ňom je, next je skladaný
+// frame, bunka je chtype (znak + farba). Pozadie je prázdno alebo okraj
+// s prekážkami pre okno (base), ten sa skladá znova len pri posune okna
+// alebo zmene terminálu. Frame píše cez scr_put len HUD, ovocie a hady
+// a tie bunky si zapíše do put; scr_begin vráti bunky minulého frame
+// na pozadie a scr_flush porovná s cur len bunky oboch frame. Celá
+// plocha sa porovnáva, len keď sa zmení pozadie alebo terminál.
+typedef struct {
+    int rows, cols;
+    chtype *cur, *next, *base;
+    int valid;              // cur matches the terminal
+
+    uint32_t *stamp;        // frame that last put the cell
+    uint32_t frame;
+    size_t *put, *prev;     // cells put in this and in the last flushed frame
+    size_t nput, nprev;
+    int board, next_board;  // background is base: on the terminal / in this frame
+    int full;               // diff the whole screen on the next flush
+
+    msg_rect_t base_win;    // base holds border + obstacles for this window
+    const obst_map_t *base_obst;
+    int base_ok;
+
+    unsigned char *key;     // inputs of the last frame drawn
+    size_t key_len, key_cap;
+} screen_t;
+
+static screen_t scr;
+
+static chtype color(int cp) { return has_colors() ? COLOR_PAIR(cp) : 0; }
+
+// nový terminál (po endwin/init_curses): cur už neplatí
+static void scr_reset(screen_t *sc) {
+    free(sc->cur);
+    free(sc->next);
+    free(sc->base);
+    free(sc->stamp);
+    free(sc->put);
+    free(sc->prev);
+    free(sc->key);
+    memset(sc, 0, sizeof(*sc));
+}
+
+// 1 ak sú vstupy frame (hlavička + dáta) rovnaké ako pri poslednom
+// nakreslenom, inak si ich zapamätá a vráti 0
+static int scr_same(screen_t *sc, const void *hdr, size_t hlen, const void *data, size_t dlen) {
+    size_t len = hlen + dlen;
+    if (sc->valid && sc->key && len == sc->key_len &&
+        memcmp(sc->key, hdr, hlen) == 0 && memcmp(sc->key + hlen, data, dlen) == 0) return 1;
+
+    if (len > sc->key_cap) {
+        unsigned char *k = realloc(sc->key, len);
+        if (!k) { sc->key_len = 0; return 0; }
+        sc->key = k;
+        sc->key_cap = len;
+    }
+    memcpy(sc->key, hdr, hlen);
+    if (dlen) memcpy(sc->key + hlen, data, dlen);
+    sc->key_len = len;
+    return 0;
+}
+
+// Poskladaný frame sa nekreslí a jeho kľúč neplatí. Jeho begin už vrátil
+// bunky minulého frame na pozadie, ďalší flush preto porovná všetko.
+static void scr_discard(screen_t *sc) {
+    sc->key_len = 0;
+    sc->full = 1;
+}
 
-    mvaddch(top, left, '+');
-    mvaddch(top, left + w + 1, '+');
-    mvaddch(top + h + 1, left, '+');
-    mvaddch(top + h + 1, left + w + 1, '+');
+// pozadie bunky i na termináli
+static chtype scr_bg(const screen_t *sc, size_t i) {
+    return sc->board ? sc->base[i] : ' ';
+}
 
+// Začne frame na celý terminál: bunky minulého frame sa vrátia na
+// pozadie, zvyšok next platí ďalej. 0 ok, -1 bez pamäte.
+static int scr_begin(screen_t *sc) {
+    int rows, cols;
+    getmaxyx(stdscr, rows, cols);
+    if (rows < 1) rows = 1;
+    if (cols < 1) cols = 1;
+
+    if (rows != sc->rows || cols != sc->cols || !sc->cur) {
+        size_t n = (size_t)rows * (size_t)cols;
+        free(sc->cur);
+        free(sc->next);
+        free(sc->base);
+        free(sc->stamp);
+        free(sc->put);
+        free(sc->prev);
+        sc->cur = malloc(n * sizeof(chtype));
+        sc->next = malloc(n * sizeof(chtype));
+        sc->base = malloc(n * sizeof(chtype));
+        sc->stamp = calloc(n, sizeof(uint32_t));
+        sc->put = malloc(n * sizeof(size_t));
+        sc->prev = malloc(n * sizeof(size_t));
+        sc->rows = rows;
+        sc->cols = cols;
+        sc->valid = 0;
+        sc->base_ok = 0;
+        sc->board = 0;
+        sc->frame = 0;
+        sc->nput = 0;
+        if (!sc->cur || !sc->next || !sc->base || !sc->stamp || !sc->put || !sc->prev) {
+            scr_reset(sc);
+            return -1;
+        }
+        for (size_t i = 0; i < n; i++) sc->next[i] = ' ';
+    }
+
+    size_t *t = sc->prev;
+    sc->prev = sc->put;
+    sc->put = t;
+    sc->nprev = sc->nput;
+    sc->nput = 0;
+    for (size_t k = 0; k < sc->nprev; k++) sc->next[sc->prev[k]] = scr_bg(sc, sc->prev[k]);
+    sc->frame++;
+    sc->next_board = 0;
+    return 0;
+}
+
+static void scr_put(screen_t *sc, int y, int x, chtype c) {
+    if (y < 0 || y >= sc->rows || x < 0 || x >= sc->cols) return;
+    size_t i = (size_t)y * (size_t)sc->cols + (size_t)x;
+    sc->next[i] = c;
+    if (sc->stamp[i] != sc->frame) {
+        sc->stamp[i] = sc->frame;
+        sc->put[sc->nput++] = i;
+    }
+}
+
+static void scr_text(screen_t *sc, int y, int x, chtype attr, const char *fmt, ...) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    for (int i = 0; buf[i]; i++) scr_put(sc, y, x + i, (chtype)(unsigned char)buf[i] | attr);
+}
+
+static void center_text(screen_t *sc, int row, const char *txt) {
+    int col = (sc->cols - (int)strlen(txt)) / 2;
+    if (col < 0) col = 0;
+    scr_text(sc, row, col, color(CP_TEXT), "%s", txt);
+}
+
+static void base_put(screen_t *sc, int y, int x, chtype c) {
+    if (y < 0 || y >= sc->rows || x < 0 || x >= sc->cols) return;
+    sc->base[(size_t)y * (size_t)sc->cols + (size_t)x] = c;
+}
+
+// Okraj okna win a prekážky v ňom (obst môže byť NULL) ako pozadie
+// frame. Skladá sa do base, kým sa okno nepohne, inak sa nemení nič.
+static void draw_board(screen_t *sc, int top, int left, const msg_rect_t *win, const obst_map_t *obst) {
+    sc->next_board = 1;
+    if (sc->base_ok && sc->base_obst == obst && memcmp(&sc->base_win, win, sizeof(*win)) == 0) return;
+
+    size_t n = (size_t)sc->rows * (size_t)sc->cols;
+    for (size_t i = 0; i < n; i++) sc->base[i] = ' ';
+
+    chtype b = color(CP_BORDER);
+    int w = win->w, h = win->h;
+    base_put(sc, top, left, '+' | b);
+    base_put(sc, top, left + w + 1, '+' | b);
+    base_put(sc, top + h + 1, left, '+' | b);
+    base_put(sc, top + h + 1, left + w + 1, '+' | b);
     for (int x = 0; x < w; x++) {
-        mvaddch(top, left + 1 + x, '-');
-        mvaddch(top + h + 1, left + 1 + x, '-');
+        base_put(sc, top, left + 1 + x, '-' | b);
+        base_put(sc, top + h + 1, left + 1 + x, '-' | b);
     }
     for (int y = 0; y < h; y++) {
-        mvaddch(top + 1 + y, left, '|');
-        mvaddch(top + 1 + y, left + w + 1, '|');
+        base_put(sc, top + 1 + y, left, '|' | b);
+        base_put(sc, top + 1 + y, left + w + 1, '|' | b);
+    }
+
+    if (obst) {
+        chtype o = '#' | color(CP_OBST);
+        for (int y = 0; y < h; y++)
+            for (int x = 0; x < w; x++)
+                if (obst_at_client(obst, win->x + x, win->y + y)) base_put(sc, top + 1 + y, left + 1 + x, o);
     }
 
-    if (has_colors()) attroff(COLOR_PAIR(CP_BORDER));
+    sc->base_win = *win;
+    sc->base_obst = obst;
+    sc->base_ok = 1;
+    sc->full = 1;
 }
 
-static void center_text(int row, const char *txt) {
-    int cols = getmaxx(stdscr);
-    int len = (int)strlen(txt);
-    int col = (cols - len) / 2;
-    if (col < 0) col = 0;
-    mvprintw(row, col, "%s", txt);
+// bunka i z next na terminál, ak sa líši; 1 ak sa poslala
+static int scr_cell(screen_t *sc, size_t i) {
+    if (sc->cur[i] == sc->next[i]) return 0;
+    sc->cur[i] = sc->next[i];
+    mvaddch((int)(i / (size_t)sc->cols), (int)(i % (size_t)sc->cols), sc->next[i]);
+    return 1;
+}
+
+// Zmenené bunky next -> terminál. Pri rovnakom pozadí stačia bunky
+// tohto a minulého frame, inak sa pozadie doplní a porovná sa všetko.
+static void scr_flush(screen_t *sc) {
+    size_t n = (size_t)sc->rows * (size_t)sc->cols;
+    int dirty = 0;
+
+    if (!sc->valid || sc->full || sc->board != sc->next_board) {
+        sc->board = sc->next_board;
+        for (size_t i = 0; i < n; i++)
+            if (sc->stamp[i] != sc->frame) sc->next[i] = scr_bg(sc, i);
+        if (!sc->valid) {
+            clear();
+            for (size_t i = 0; i < n; i++) sc->cur[i] = ' ';
+            dirty = 1;
+        }
+        for (size_t i = 0; i < n; i++) dirty |= scr_cell(sc, i);
+    } else {
+        for (size_t k = 0; k < sc->nprev; k++) dirty |= scr_cell(sc, sc->prev[k]);
+        for (size_t k = 0; k < sc->nput; k++) dirty |= scr_cell(sc, sc->put[k]);
+    }
+
+    sc->valid = 1;
+    sc->full = 0;
+    if (dirty) refresh();
 }
 
-static void render_frame(const client_state_t *st, const msg_snapshot_t *s, const msg_point_t *pts) {
-    erase();
+// Okno veľkosti terminálu (cols x rows buniek) vo výreze v, centrované
+// na (cx, cy); 0 ak je terminál menší ako MIN_VIEW a výrez väčší.
+static int fit_window(const msg_rect_t *v, int cx, int cy, int cols, int rows, msg_rect_t *out) {
+    out->w = v->w < cols ? v->w : cols;
+    out->h = v->h < rows ? v->h : rows;
+    if (out->w < (v->w < MIN_VIEW ? v->w : MIN_VIEW) || out->h < (v->h < MIN_VIEW ? v->h : MIN_VIEW)) return 0;
+
+    out->x = cx - out->w / 2;
+    out->y = cy - out->h / 2;
+    if (out->x + out->w > v->x + v->w) out->x = v->x + v->w - out->w;
+    if (out->y + out->h > v->y + v->h) out->y = v->y + v->h - out->h;
+    if (out->x < v->x) out->x = v->x;
+    if (out->y < v->y) out->y = v->y;
+    return 1;
+}
 
-    int rows, cols;
-    getmaxyx(stdscr, rows, cols);
+static void too_small(screen_t *sc, int need_w, int need_h) {
+    scr_text(sc, 3, 2, color(CP_TEXT), "Terminal too small. Resize window (need at least %dx%d).", need_w, need_h);
+}
+
+// Kreslí sa okno z výrezu, ktorý server poslal; kým sa doska zmestí do
+// terminálu, je to celá doska. Rovnaký snapshot (okrem seq) na rovnako
+// veľkom termináli sa nekreslí vôbec.
+static int compose_frame(const client_state_t *st, const obst_map_t *obst, const msg_snapshot_t *s, const msg_point_t *pts) {
+    int n = s->npoints;
+    if (n < 0) n = 0;
+
+    struct {
+        msg_snapshot_t s;
+        int best;
+        const obst_map_t *obst;
+        int rows, cols;
+    } key;
+    memset(&key, 0, sizeof(key));
+    key.s = *s;
+    key.s.seq = 0;
+    key.best = st->best_score;
+    key.obst = obst;
+    getmaxyx(stdscr, key.rows, key.cols);
+    if (scr_same(&scr, &key, sizeof(key), pts, (size_t)n * sizeof(*pts))) return 0;
+    if (scr_begin(&scr) != 0) return 0;
 
     int top = 2;
     int left = 2;
 
-    if (has_colors()) attron(COLOR_PAIR(CP_TEXT));
-    mvprintw(0, 2, "POS Snake | WASD move | P pause | R restart | M menu | Q quit");
-    if (s->mode == MODE_TIMED) {
-        mvprintw(1, 2, "Score: %d  Best: %d  Elapsed: %ds  Left: %ds  Map: %dx%d",
+    chtype text = color(CP_TEXT);
+    if (st->watch) {
+        scr_text(&scr, 0, 2, text, "POS Snake | watching session %d | M menu | Q quit", st->watch);
+        scr_text(&scr, 1, 2, text, "Score: %d  Elapsed: %ds  Map: %dx%d", s->score, s->elapsed_s, s->w, s->h);
+    } else if (s->mode == MODE_TIMED) {
+        scr_text(&scr, 0, 2, text, "POS Snake | WASD move | P pause | R restart | M menu | Q quit");
+        scr_text(&scr, 1, 2, text, "Score: %d  Best: %d  Elapsed: %ds  Left: %ds  Map: %dx%d",
                  s->score, st->best_score, s->elapsed_s, s->time_left_s, s->w, s->h);
     } else {
-        mvprintw(1, 2, "Score: %d  Best: %d  Elapsed: %ds  Map: %dx%d",
+        scr_text(&scr, 0, 2, text, "POS Snake | WASD move | P pause | R restart | M menu | Q quit");
+        scr_text(&scr, 1, 2, text, "Score: %d  Best: %d  Elapsed: %ds  Map: %dx%d",
                  s->score, st->best_score, s->elapsed_s, s->w, s->h);
     }
-    if (has_colors()) attroff(COLOR_PAIR(CP_TEXT));
 
-    if (rows < top + s->h + 3 || cols < left + s->w + 3) {
-        if (has_colors()) attron(COLOR_PAIR(CP_TEXT));
-        mvprintw(3, 2, "Terminal too small. Resize window (need at least %dx%d).",
-                 left + s->w + 3, top + s->h + 3);
-        if (has_colors()) attroff(COLOR_PAIR(CP_TEXT));
-        refresh();
-        return;
+    // body v pts sú vo výreze a hlava je v jeho strede
+    int cx = n > 0 ? pts[0].x : s->view.x + s->view.w / 2;
+    int cy = n > 0 ? pts[0].y : s->view.y + s->view.h / 2;
+
+    msg_rect_t win;
+    if (!fit_window(&s->view, cx, cy, scr.cols - left - 3, scr.rows - top - 3, &win)) {
+        too_small(&scr, left + MIN_VIEW + 3, top + MIN_VIEW + 3);
+        return 1;
     }
 
-    draw_border(top, left, s->w, s->h);
+    draw_board(&scr, top, left, &win, obst); // obst len pri mape z RESP_MAP_INFO
+
+    int fx = s->fruit_x - win.x, fy = s->fruit_y - win.y;
+    if (s->fruit_x >= 0 && fx >= 0 && fx < win.w && fy >= 0 && fy < win.h)
+        scr_put(&scr, top + 1 + fy, left + 1 + fx, 'o' | color(CP_FRUIT));
 
-    if (st->world_type == WORLD_OBSTACLES && st->obst) {
-        if (has_colors()) attron(COLOR_PAIR(CP_OBST));
-        for (int y = 0; y < st->h; y++)
-            for (int x = 0; x < st->w; x++)
-                if (obst_at_client(st, x, y)) mvaddch(top + 1 + y, left + 1 + x, '#');
-        if (has_colors()) attroff(COLOR_PAIR(CP_OBST));
+    if (n > 0) {
+        chtype body = 'o' | color(CP_SNAKE_BODY);
+        for (int i = n - 1; i >= 0; i--) {
+            int x = pts[i].x - win.x;
+            int y = pts[i].y - win.y;
+            if (x < 0 || x >= win.w || y < 0 || y >= win.h) continue;
+            scr_put(&scr, top + 1 + y, left + 1 + x, i == 0 ? ('@' | color(CP_SNAKE_HEAD)) : body);
+        }
     }
 
-    if (has_colors()) attron(COLOR_PAIR(CP_FRUIT));
-    mvaddch(top + 1 + s->fruit_y, left + 1 + s->fruit_x, 'o');
-    if (has_colors()) attroff(COLOR_PAIR(CP_FRUIT));
+    if (s->paused) center_text(&scr, top + win.h / 2, "PAUSED");
 
-    int n = s->snake_len;
-    if (n > MAX_POINTS) n = MAX_POINTS;
-    if (n > 0) {
-        if (has_colors()) attron(COLOR_PAIR(CP_SNAKE_HEAD));
-        mvaddch(top + 1 + pts[0].y, left + 1 + pts[0].x, '@');
-        if (has_colors()) attroff(COLOR_PAIR(CP_SNAKE_HEAD));
-
-        if (has_colors()) attron(COLOR_PAIR(CP_SNAKE_BODY));
-        for (int i = 1; i < n; i++) {
-            int x = pts[i].x;
-            int y = pts[i].y;
-            if (x >= 0 && x < s->w && y >= 0 && y < s->h) {
-                mvaddch(top + 1 + y, left + 1 + x, 'o');
-            }
+    if (s->gameover) {
+        center_text(&scr, top + (win.h / 2) - 1, s->gameover == GAMEOVER_WON ? "YOU WIN" : "GAME OVER");
+        center_text(&scr, top + (win.h / 2) + 1, "Press R to restart or M for menu");
+    }
+    return 1;
+}
+
+static void render_frame(const client_state_t *st, const obst_map_t *obst, const msg_snapshot_t *s, const msg_point_t *pts) {
+    if (compose_frame(st, obst, s, pts)) scr_flush(&scr);
+}
+
+// Najnovší keyframe zo zdieľanej pamäte: body sa čítajú priamo
+// z mapovania do scr.next a na terminál ide frame, len ak seq slotu
+// po poskladaní sedí. Inak ho server medzitým prepísal, frame sa zahodí
+// a zmenené frames hneď zobudí ďalšie kreslenie. Čítanie je ohraničené
+// slotom aj pri roztrhnutej hlavičke, npoints sa kontroluje voči len.
+static void render_shm(client_state_t *st, const obst_map_t *obst, const ipc_shm_t *shm) {
+    ipc_shm_read_t r;
+    const unsigned char *f = ipc_shm_read_begin(shm, &r);
+    size_t head = sizeof(msg_hdr_t) + sizeof(msg_snapshot_t);
+    if (!f || r.len < head) return;
+
+    msg_snapshot_t s;
+    memcpy(&s, f + sizeof(msg_hdr_t), sizeof(s));
+    if (s.w <= 0 || s.h <= 0 || !view_valid(&s.view, s.w, s.h)) return;
+    if (s.npoints < 0 || (size_t)s.npoints > (r.len - head) / sizeof(msg_point_t)) return;
+
+    int best = st->best_score;
+    if (!st->watch && s.score > best) st->best_score = s.score;
+    int ready = compose_frame(st, obst, &s, (const msg_point_t *)(const void *)(f + head));
+    if (!ipc_shm_read_ok(shm, &r)) {
+        st->best_score = best;
+        scr_discard(&scr);
+        return;
+    }
+    if (ready) scr_flush(&scr);
+}
+
+// Frame nesie len výrez view okolo hlavy; kreslí sa z neho okno veľké
+// ako terminál, centrované na vlastnú hlavu.
+static void render_arena(const client_state_t *st, const unsigned char *frame) {
+    msg_arena_t a;
+    memcpy(&a, frame, sizeof(a));
+    const msg_arena_snake_t *sn = (const msg_arena_snake_t *)(const void *)(frame + sizeof(a));
+    const msg_point_t *pts = (const msg_point_t *)(const void *)(frame + sizeof(a) + (size_t)a.nsnakes * sizeof(*sn));
+    size_t npts = 0;
+    for (int i = 0; i < a.nsnakes; i++) npts += (size_t)sn[i].npoints;
+    size_t len = (size_t)((const unsigned char *)(pts + npts) - frame);
+
+    struct {
+        int slot;
+        int rows, cols;
+    } key;
+    memset(&key, 0, sizeof(key));
+    key.slot = st->slot;
+    getmaxyx(stdscr, key.rows, key.cols);
+    // seq je prvé pole msg_arena_t, do porovnania nepatrí
+    if (scr_same(&scr, &key, sizeof(key), frame + sizeof(a.seq), len - sizeof(a.seq))) return;
+    if (scr_begin(&scr) != 0) return;
+
+    int top = 2;
+    int left = 2;
+
+    // stred okna: vlastná hlava, inak stred výrezu
+    const msg_arena_snake_t *me = NULL;
+    int cx = a.view.x + a.view.w / 2, cy = a.view.y + a.view.h / 2;
+    const msg_point_t *p = pts;
+    for (int i = 0; i < a.nsnakes; i++) {
+        if (sn[i].slot == st->slot) {
+            me = &sn[i];
+            if (sn[i].flags & ARENA_SNAKE_HEAD) { cx = p->x; cy = p->y; }
         }
-        if (has_colors()) attroff(COLOR_PAIR(CP_SNAKE_BODY));
+        p += sn[i].npoints;
     }
 
-    if (s->paused) {
-        if (has_colors()) attron(COLOR_PAIR(CP_TEXT));
-        center_text(top + s->h / 2, "PAUSED");
-        if (has_colors()) attroff(COLOR_PAIR(CP_TEXT));
+    chtype text = color(CP_TEXT);
+    scr_text(&scr, 0, 2, text, "POS Snake Arena | WASD move | R respawn | M menu | Q quit");
+    scr_text(&scr, 1, 2, text, "Score: %d  Near: %d  Elapsed: %ds  Map: %dx%d  Pos: %d,%d  Fruit: %d,%d",
+             me ? me->score : 0, a.nsnakes, a.elapsed_s, a.w, a.h, cx, cy, a.fruit_x, a.fruit_y);
+
+    msg_rect_t win;
+    if (!fit_window(&a.view, cx, cy, scr.cols - left - 3, scr.rows - top - 3, &win)) {
+        too_small(&scr, left + MIN_VIEW + 3, top + MIN_VIEW + 3);
+        scr_flush(&scr);
+        return;
+    }
+    int x0 = win.x, y0 = win.y, cw = win.w, ch = win.h;
+
+    draw_board(&scr, top, left, &win, NULL);
+
+    if (a.fruit_x >= x0 && a.fruit_x < x0 + cw && a.fruit_y >= y0 && a.fruit_y < y0 + ch)
+        scr_put(&scr, top + 1 + a.fruit_y - y0, left + 1 + a.fruit_x - x0, 'o' | color(CP_FRUIT));
+
+    // vlastný had @/o zelený, ostatní X/x
+    for (int i = 0; i < a.nsnakes; i++) {
+        int own = (sn[i].slot == st->slot);
+        int head = (sn[i].flags & ARENA_SNAKE_HEAD) != 0;
+        chtype attr = color(own ? CP_SNAKE_BODY : CP_OTHER);
+        for (int k = 0; k < sn[i].npoints; k++) {
+            int x = pts[k].x - x0;
+            int y = pts[k].y - y0;
+            if (x < 0 || x >= cw || y < 0 || y >= ch) continue;
+            chtype c = (k == 0 && head) ? (own ? '@' : 'X') : (own ? 'o' : 'x');
+            scr_put(&scr, top + 1 + y, left + 1 + x, c | attr);
+        }
+        pts += sn[i].npoints;
     }
 
-    if (s->gameover) {
-        if (has_colors()) attron(COLOR_PAIR(CP_TEXT));
-        center_text(top + (s->h / 2) - 1, "GAME OVER");
-        center_text(top + (s->h / 2) + 1, "Press R to restart or M for menu");
-        if (has_colors()) attroff(COLOR_PAIR(CP_TEXT));
+    if (me && !me->alive) center_text(&scr, top + ch / 2, "YOU CRASHED - press R to respawn");
+
+    scr_flush(&scr);
+}
+
+// Čaká na klávesu (stdin) alebo na recv_thread (wake_fd), bez timeoutu.
+// 1 ak recv_thread niečo priniesol; 0 pri klávese alebo signáli
+// (SIGWINCH od curses -> KEY_RESIZE), running = 0 ak terminál zmizol.
+static int wait_events(client_state_t *st) {
+    struct pollfd pfd[2] = {
+        { .fd = STDIN_FILENO, .events = POLLIN },
+        { .fd = st->wake_fd, .events = POLLIN }
+    };
+    if (poll(pfd, 2, -1) < 0) {
+        if (errno != EINTR) st->running = 0;
+        return 0;
     }
+    if (pfd[0].revents & (POLLHUP | POLLERR | POLLNVAL)) st->running = 0;
 
-    refresh();
+    uint64_t n = 0;
+    if ((pfd[1].revents & POLLIN) && read(st->wake_fd, &n, sizeof(n)) == (ssize_t)sizeof(n)) return 1;
+    return 0;
 }
 
 static int read_int_range(const char *prompt, int min, int max) {
@@ -296,109 +1042,161 @@ static int read_int_range(const char *prompt, int min, int max) {
     }
 }
 
-/* ===================== fork+exec server management ===================== */
+/* ===================== server ===================== */
 
-static pid_t server_pid = -1;
+#define SERVER_IDLE_S 300     // a server started by the client exits after this long without clients
+#define SERVER_READY_MS 2000
 
-static int start_server_process(void) {
-    // ak ostal socket po páde, radšej ho odstráň
-    unlink(SNAKE_SOCK_PATH);
+// Pripojí sa k bežiacemu serveru. Ak nebeží, spustí ho ako démona (-d,
+// nová session, výstup do SNAKE_LOG_PATH) a počká na jeho bajt cez rúru
+// (-r) namiesto pollovania socketu. Server prežije klienta, ďalšie hry
+// idú na ten istý proces a sám skončí po SERVER_IDLE_S bez klientov.
+static int connect_server(void) {
+    int fd = ipc_client_connect(SNAKE_SOCK_PATH);
+    if (fd >= 0) return fd;
+
+    int ready[2];
+    if (pipe(ready) != 0) {
+        perror("pipe");
+        return -1;
+    }
 
     pid_t pid = fork();
     if (pid < 0) {
         perror("fork");
+        close(ready[0]);
+        close(ready[1]);
         return -1;
     }
 
     if (pid == 0) {
-        // child -> spustí server
-        execl("./build/server", "server", NULL);
+        // medzičlánok: druhý fork, aby démon nebol dieťa klienta
+        close(ready[0]);
+        if (setsid() < 0) _exit(1);
+        pid_t d = fork();
+        if (d != 0) _exit(d < 0);
+
+        int in = open("/dev/null", O_RDONLY);
+        int log = open(SNAKE_LOG_PATH, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (in >= 0) dup2(in, STDIN_FILENO);
+        if (log >= 0) {
+            dup2(log, STDOUT_FILENO);
+            dup2(log, STDERR_FILENO);
+        }
+
+        char rfd[16], idle[16];
+        snprintf(rfd, sizeof(rfd), "%d", ready[1]);
+        snprintf(idle, sizeof(idle), "%d", SERVER_IDLE_S);
+        execl("./build/server", "server", "-d", "-i", idle, "-r", rfd, (char *)NULL);
         perror("exec ./build/server");
         _exit(1);
     }
 
-    // parent -> klient
-    server_pid = pid;
-
-    // počkáme na socket (max ~2s)
-    for (int i = 0; i < 20; i++) {
-        if (access(SNAKE_SOCK_PATH, F_OK) == 0) return 0;
-        usleep(100000);
-    }
+    close(ready[1]);
+    (void)waitpid(pid, NULL, 0);
 
-    fprintf(stderr, "Server did not create socket in time: %s\n", SNAKE_SOCK_PATH);
-    return -1;
-}
+    struct pollfd pfd = { .fd = ready[0], .events = POLLIN };
+    char c;
+    int ok = poll(&pfd, 1, SERVER_READY_MS) == 1 && read(ready[0], &c, 1) == 1;
+    close(ready[0]);
 
-static void stop_server_process(void) {
-    if (server_pid > 0) {
-        (void)waitpid(server_pid, NULL, 0);
-        server_pid = -1;
-    }
+    // aj bez bajtu: server mohol medzitým spustiť iný klient
+    fd = ipc_client_connect(SNAKE_SOCK_PATH);
+    if (fd < 0) fprintf(stderr, "Server did not start%s, see %s\n", ok ? "" : " in time", SNAKE_LOG_PATH);
+    return fd;
 }
 
 /* ======================================================================= */
 
-static int run_one_game(void) {
-    int cols, rows;
-    term_size(&cols, &rows);
+// Aréna žije na zdieľanom serveri, ktorý beží ďalej aj po odchode.
+static int run_arena(void) {
+    int fd = connect_server();
+    if (fd < 0) return 2;
 
-    int max_w_term = cols - 5;
-    int max_h_term = rows - 5;
-
-    if (max_w_term < 10) max_w_term = 10;
-    if (max_h_term < 10) max_h_term = 10;
-
-    printf("Detected terminal: %dx%d\n", cols, rows);
+    init_curses();
+    cmd_batch_t b = {.len = 0};
+    batch_add(&b, CMD_JOIN_ARENA, ARENA_NUMBER);
+    batch_add(&b, CMD_SET_VIEW, view_arg(COLS, LINES));
+    batch_send(fd, &b);
 
-    printf("GAME MODE:\n  1) Standard\n  2) Timed\n");
-    int mode_in = read_int_range("Select (1-2):", 1, 2);
+    client_state_t st;
+    memset(&st, 0, sizeof(st));
+    st.fd = fd;
+    st.running = 1;
+    st.slot = -1;
+    pthread_mutex_init(&st.lock, NULL);
 
-    int duration = 60;
-    if (mode_in == MODE_TIMED) duration = read_int_range("Set time in seconds (10-3600):", 10, 3600);
+    st.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (st.wake_fd < 0) {
+        endwin();
+        perror("eventfd");
+        close(fd);
+        return 2;
+    }
 
-    printf("WORLD TYPE:\n  1) No obstacles (WRAP)\n  2) With obstacles (fixed 45x30 from file)\n");
-    int wt_in = read_int_range("Select (1-2):", 1, 2);
+    pthread_t th_recv;
+    if (pthread_create(&th_recv, NULL, recv_thread, &st) != 0) {
+        endwin();
+        perror("pthread_create(recv)");
+        close(st.wake_fd);
+        close(fd);
+        return 2;
+    }
 
-    int w = 0, h = 0;
+    int go_menu = 0;
+    unsigned char *frame = NULL;
 
-    if (wt_in == WORLD_OBSTACLES) {
-        w = OB_W; h = OB_H;
-        printf("Using obstacle map %s (%dx%d)\n", OB_FILE, w, h);
-        if (w > max_w_term || h > max_h_term) {
-            printf("WARNING: obstacle map needs at least %dx%d terminal. Your terminal is %dx%d.\n",
-                   w + 5, h + 5, cols, rows);
+    // klávesy idú von hneď, kreslí sa len nový frame alebo po resize
+    while (st.running) {
+        int draw = wait_events(&st);
+
+        int ch;
+        while (st.running && (ch = getch()) != ERR) {
+            if (ch == 'w' || ch == 'W') send_cmd(fd, CMD_DIR, DIR_UP);
+            else if (ch == 's' || ch == 'S') send_cmd(fd, CMD_DIR, DIR_DOWN);
+            else if (ch == 'a' || ch == 'A') send_cmd(fd, CMD_DIR, DIR_LEFT);
+            else if (ch == 'd' || ch == 'D') send_cmd(fd, CMD_DIR, DIR_RIGHT);
+            else if (ch == 'r' || ch == 'R') send_cmd(fd, CMD_RESTART, 0);
+            else if (ch == KEY_RESIZE) {
+                scr.valid = 0;
+                draw = 1;
+                send_view(fd, COLS, LINES);
+            } else if (ch == 'm' || ch == 'M' || ch == 'q' || ch == 'Q') {
+                send_cmd(fd, CMD_BACK_TO_MENU, 0);
+                go_menu = (ch == 'm' || ch == 'M');
+                st.running = 0;
+            }
         }
-    } else {
-        int wmax = (max_w_term < 60) ? max_w_term : 60;
-        int hmax = (max_h_term < 40) ? max_h_term : 40;
+        if (!st.running || !draw) continue;
 
-        char pw[128], ph[128];
-        snprintf(pw, sizeof(pw), "Map width (10-%d):", wmax);
-        snprintf(ph, sizeof(ph), "Map height (10-%d):", hmax);
+        pthread_mutex_lock(&st.lock);
+        if (st.arena_frame) {
+            free(frame);
+            frame = st.arena_frame;
+            st.arena_frame = NULL;
+        }
+        pthread_mutex_unlock(&st.lock);
 
-        w = read_int_range(pw, 10, wmax);
-        h = read_int_range(ph, 10, hmax);
+        if (frame) render_arena(&st, frame);
     }
 
-    // ========== NOVÁ HRA -> klient spustí server ==========
-    if (start_server_process() != 0) {
-        fprintf(stderr, "Failed to start server.\n");
-        return 2;
-    }
-    // ======================================================
+    pthread_join(th_recv, NULL);
 
-    int fd = ipc_client_connect(SNAKE_SOCK_PATH);
+    free(frame);
+    free(st.arena_frame);
+    pthread_mutex_destroy(&st.lock);
+    close(st.wake_fd);
+    close(fd);
 
-    send_cmd(fd, CMD_SET_MODE, mode_in);
-    if (mode_in == MODE_TIMED) send_cmd(fd, CMD_SET_TIME, duration);
-    send_cmd(fd, CMD_SET_WORLD, wt_in);
+    endwin();
+    scr_reset(&scr);
 
-    if (wt_in == WORLD_WRAP) {
-        int32_t packed = (int32_t)((w << 16) | (h & 0xFFFF));
-        send_cmd(fd, CMD_SET_SIZE, packed);
-    }
+    return go_menu ? 0 : 2;
+}
 
+// Hra alebo sledovanie cudzej hry na už pripojenom fd, po koniec
+// spojenia; 1 = späť do menu, 0 = koniec, -1 = chyba pri štarte.
+static int play(int fd, int watch) {
     init_curses();
 
     client_state_t st;
@@ -406,93 +1204,200 @@ static int run_one_game(void) {
     st.fd = fd;
     st.running = 1;
     pthread_mutex_init(&st.lock, NULL);
-    st.best_score = load_best_score();
-    st.world_type = (world_type_t)wt_in;
-    st.w = w;
-    st.h = h;
-
-    if (st.world_type == WORLD_OBSTACLES) {
-        if (load_obstacles_client(&st, OB_FILE) != 0) {
-            endwin();
-            fprintf(stderr, "Failed to load obstacle file: %s\n", OB_FILE);
-            close(fd);
-            stop_server_process();
-            return 2;
-        }
+    frames_init(&st.frames);
+    st.watch = watch;
+    if (!watch) st.best_score = load_best_score();
+
+    st.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (st.wake_fd < 0) {
+        endwin();
+        perror("eventfd");
+        close(fd);
+        return -1;
     }
 
     pthread_t th_recv;
     if (pthread_create(&th_recv, NULL, recv_thread, &st) != 0) {
         endwin();
         perror("pthread_create(recv)");
+        close(st.wake_fd);
         close(fd);
-        free(st.obst);
-        stop_server_process();
-        return 2;
+        return -1;
     }
 
     int go_menu = 0;
 
+    // klávesy idú von hneď, kreslí sa len po snapshote/delte alebo resize
     while (st.running) {
-        int ch = getch();
-
-        if (ch == 'w' || ch == 'W') send_cmd(fd, CMD_DIR, DIR_UP);
-        else if (ch == 's' || ch == 'S') send_cmd(fd, CMD_DIR, DIR_DOWN);
-        else if (ch == 'a' || ch == 'A') send_cmd(fd, CMD_DIR, DIR_LEFT);
-        else if (ch == 'd' || ch == 'D') send_cmd(fd, CMD_DIR, DIR_RIGHT);
-        else if (ch == 'p' || ch == 'P') send_cmd(fd, CMD_TOGGLE_PAUSE, 0);
-        else if (ch == 'r' || ch == 'R') send_cmd(fd, CMD_RESTART, 0);
-        else if (ch == 'm' || ch == 'M') {
-            // aby server zanikol a ostal iba klient v menu:
-            send_cmd(fd, CMD_QUIT, 0);
-            go_menu = 1;
-            st.running = 0;
-            break;
-        } else if (ch == 'q' || ch == 'Q') {
-            send_cmd(fd, CMD_QUIT, 0);
-            go_menu = 0;
-            st.running = 0;
-            break;
+        int draw = wait_events(&st);
+
+        int ch;
+        while (st.running && (ch = getch()) != ERR) {
+            if (ch == 'w' || ch == 'W') send_cmd(fd, CMD_DIR, DIR_UP);
+            else if (ch == 's' || ch == 'S') send_cmd(fd, CMD_DIR, DIR_DOWN);
+            else if (ch == 'a' || ch == 'A') send_cmd(fd, CMD_DIR, DIR_LEFT);
+            else if (ch == 'd' || ch == 'D') send_cmd(fd, CMD_DIR, DIR_RIGHT);
+            else if (ch == 'p' || ch == 'P') send_cmd(fd, CMD_TOGGLE_PAUSE, 0);
+            else if (ch == 'r' || ch == 'R') send_cmd(fd, CMD_RESTART, 0);
+            else if (ch == KEY_RESIZE) {
+                scr.valid = 0;
+                draw = 1;
+                send_view(fd, COLS, LINES);
+            } else if (ch == 'm' || ch == 'M' || ch == 'q' || ch == 'Q') {
+                // server beží ďalej pre ďalšie hry, končí len táto session
+                send_cmd(fd, CMD_BACK_TO_MENU, 0);
+                go_menu = (ch == 'm' || ch == 'M');
+                st.running = 0;
+            }
+        }
+        if (!st.running) break;
+
+        if (st.want_keyframe) {
+            st.want_keyframe = 0;
+            send_cmd(fd, CMD_KEYFRAME, 0);
+        }
+        if (st.want_map) {
+            st.want_map = 0;
+            send_cmd(fd, CMD_GET_MAP, 0);
         }
+        if (!draw) continue;
 
         pthread_mutex_lock(&st.lock);
-        int have = st.have_last;
-        msg_snapshot_t snap = st.snap;
-        int n = snap.snake_len;
-        if (n > MAX_POINTS) n = MAX_POINTS;
-        msg_point_t local[MAX_POINTS];
-        for (int i = 0; i < n; i++) local[i] = st.pts[i];
+        const obst_map_t *obst = st.map ? &st.map->obst : NULL;
+        ipc_shm_t *shm = st.shm;
+        if (shm) {
+            pthread_mutex_unlock(&st.lock);
+            render_shm(&st, obst, shm);
+            continue;
+        }
         pthread_mutex_unlock(&st.lock);
 
-        if (have) {
-            if (snap.score > st.best_score) st.best_score = snap.score;
-            render_frame(&st, &snap, local);
+        const frame_buf_t *f = frames_take(&st.frames);
+        if (f->valid) {
+            if (f->snap.score > st.best_score) st.best_score = f->snap.score;
+            render_frame(&st, obst, &f->snap, f->pts + f->head);
         }
-
-        usleep(20000);
     }
 
     pthread_join(th_recv, NULL);
+    if (st.shm_started) pthread_join(st.shm_waiter, NULL);
 
-    save_best_score(st.best_score);
+    if (!watch) save_best_score(st.best_score);
 
-    free(st.obst);
+    ipc_shm_unmap(st.shm, st.shm_size);
+    free(st.ring);
+    frames_free(&st.frames);
+    map_free(st.map);
     pthread_mutex_destroy(&st.lock);
+    close(st.wake_fd);
     close(fd);
 
     endwin();
+    scr_reset(&scr);
+
+    return go_menu;
+}
 
-    // ========== po skončení hry server musí zaniknúť ==========
-    stop_server_process();
-    // =========================================================
-    //
+// Divák sa pripojí k bežiacemu serveru (nespúšťa ho, hru hrá niekto iný)
+// a sleduje hru podľa čísla session, ktoré server vypisuje.
+static int run_watch(void) {
+    int id = read_int_range("Session number to watch:", 1, INT32_MAX);
 
-    return go_menu ? 0 : 2;
+    int fd = ipc_client_connect(SNAKE_SOCK_PATH);
+    if (fd < 0) {
+        perror("connect (is a game running?)");
+        return 0;
+    }
+    send_cmd(fd, CMD_SPECTATE, id);
+
+    int go_menu = play(fd, id);
+    return go_menu == 1 ? 0 : 2;
 }
 
-int main(void) {
+static int run_one_game(int shm) {
+    int cols, rows;
+    term_size(&cols, &rows);
+
+    int max_w_term = cols - 5;
+    int max_h_term = rows - 5;
+
+    if (max_w_term < 10) max_w_term = 10;
+    if (max_h_term < 10) max_h_term = 10;
+
+    printf("Detected terminal: %dx%d\n", cols, rows);
+
+    printf("GAME MODE:\n  1) Standard\n  2) Timed\n  3) Arena (shared board, other players and bots)\n  4) Watch a running game\n");
+    int mode_in = read_int_range("Select (1-4):", 1, 4);
+    if (mode_in == MENU_ARENA) return run_arena();
+    if (mode_in == MENU_WATCH) return run_watch();
+
+    int duration = 60;
+    if (mode_in == MODE_TIMED) duration = read_int_range("Set time in seconds (10-3600):", 10, 3600);
+
+    static const int speed_ms[] = {120, 60, MIN_TICK_MS};
+    printf("SPEED:\n  1) Normal (120 ms)\n  2) Fast (60 ms)\n  3) Turbo (%d ms)\n", MIN_TICK_MS);
+    int speed_in = read_int_range("Select (1-3):", 1, 3);
+
+    printf("WORLD TYPE:\n  1) No obstacles (WRAP)\n  2) With obstacles (map from the server)\n");
+    int wt_in = read_int_range("Select (1-2):", 1, 2);
+
+    int w = 0, h = 0;
+    int map_id = 1;
+
+    // mapu aj jej rozmer pošle server; neplatné číslo necháva mapu 1
+    if (wt_in == WORLD_OBSTACLES) {
+        char pm[64];
+        snprintf(pm, sizeof(pm), "Map number in the server's catalog (1-%d):", MAX_MAPS);
+        map_id = read_int_range(pm, 1, MAX_MAPS);
+    } else {
+        int wmax = (max_w_term < 60) ? max_w_term : 60;
+        int hmax = (max_h_term < 40) ? max_h_term : 40;
+
+        char pw[128], ph[128];
+        snprintf(pw, sizeof(pw), "Map width (10-%d):", wmax);
+        snprintf(ph, sizeof(ph), "Map height (10-%d):", hmax);
+
+        w = read_int_range(pw, 10, wmax);
+        h = read_int_range(ph, 10, hmax);
+    }
+
+    // nová hra = nová session na bežiacom serveri (ak nebeží, spustí sa)
+    int fd = connect_server();
+    if (fd < 0) return 2;
+
+    // celý config jedným write(), server ho spracuje z jedného read()
+    cmd_batch_t b = {.len = 0};
+    batch_add(&b, CMD_SET_DELTA, DELTA_VERSION);
+    if (shm) batch_add(&b, CMD_SET_SHM, 1);
+    batch_add(&b, CMD_SET_VIEW, view_arg(cols, rows));
+    batch_add(&b, CMD_SET_TICK, speed_ms[speed_in - 1]);
+    batch_add(&b, CMD_SET_MODE, mode_in);
+    if (mode_in == MODE_TIMED) batch_add(&b, CMD_SET_TIME, duration);
+    if (wt_in == WORLD_OBSTACLES) batch_add(&b, CMD_SET_MAP, map_id);
+    batch_add(&b, CMD_SET_WORLD, wt_in);
+    if (wt_in == WORLD_WRAP) batch_add(&b, CMD_SET_SIZE, (int32_t)((w << 16) | (h & 0xFFFF)));
+    batch_send(fd, &b);
+
+    int go_menu = play(fd, 0);
+    return go_menu == 1 ? 0 : 2;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [-m]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    // -m: vlastná hra cez zdieľanú pamäť (server na tom istom stroji)
+    // namiesto delta frames po sockete
+    int shm = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "m")) != -1) {
+        if (opt == 'm') shm = 1;
+        else { usage(argv[0]); return 1; }
+    }
+
     for (;;) {
-        int rc = run_one_game();
+        int rc = run_one_game(shm);
         if (rc == 0) {
             printf("\n[client] Returned to menu.\n\n");
             continue;
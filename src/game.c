@@ -0,0 +1,763 @@
+#include "game.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NS_PER_S 1000000000LL
+#define SPAWN_LEN 3
+#define SPAWN_TRIES 64
+#define SNAKE_CAP0 64
+
+// splitmix64
+static uint64_t next_rand(game_t *g) {
+    uint64_t z = (g->rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static int rand_range(game_t *g, int a, int b) {
+    return a + (int)((next_rand(g) >> 32) % (uint64_t)(b - a + 1));
+}
+
+static int is_opposite(dir_t a, dir_t b) {
+    return (a == DIR_UP && b == DIR_DOWN) ||
+           (a == DIR_DOWN && b == DIR_UP) ||
+           (a == DIR_LEFT && b == DIR_RIGHT) ||
+           (a == DIR_RIGHT && b == DIR_LEFT);
+}
+
+static int same_point(msg_point_t a, msg_point_t b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+/* ===================== dlaždice ===================== */
+
+static int tiles_for(int cells) {
+    return (cells + CHUNK - 1) >> CHUNK_SHIFT;
+}
+
+static int tile_index(const game_t *g, int x, int y) {
+    return (y >> CHUNK_SHIFT) * g->tiles_w + (x >> CHUNK_SHIFT);
+}
+
+static int tile_offset(int x, int y) {
+    return ((y & (CHUNK - 1)) << CHUNK_SHIFT) | (x & (CHUNK - 1));
+}
+
+// 8 bitov od LSB -> 8 bajtov CELL_OBST/CELL_FREE (little endian)
+static uint64_t spread_bits(unsigned b) {
+    uint64_t v = ((uint64_t)b * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+    return ((v + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+}
+
+// rozmer dlaždice t na doske (pri pravom a dolnom okraji menší)
+static void tile_extent(const game_t *g, int t, int *x0, int *y0, int *xn, int *yn) {
+    *x0 = (t % g->tiles_w) << CHUNK_SHIFT;
+    *y0 = (t / g->tiles_w) << CHUNK_SHIFT;
+    *xn = g->w - *x0 < CHUNK ? g->w - *x0 : CHUNK;
+    *yn = g->h - *y0 < CHUNK ? g->h - *y0 : CHUNK;
+}
+
+// zoznam voľných buniek dlaždice z occ, bunky mimo dosky doň nepatria
+static void tile_index_free(tile_t *tl, int xn, int yn) {
+    tl->free_len = 0;
+    for (int y = 0; y < yn; y++) {
+        for (int x = 0; x < xn; x++) {
+            int o = (y << CHUNK_SHIFT) | x;
+            if (tl->occ[o] != CELL_FREE) continue;
+            tl->free_pos[o] = (uint16_t)tl->free_len;
+            tl->free_cells[tl->free_len++] = (uint16_t)o;
+        }
+    }
+}
+
+// Dlaždica t len s prekážkami mapy, bunky mimo dosky ostanú voľné.
+// Volá sa pri každom resete pre každú dlaždicu, preto po 8 bunkách.
+static void tile_fill(const game_t *g, int t, tile_t *tl) {
+    int x0, y0, xn, yn;
+    tile_extent(g, t, &x0, &y0, &xn, &yn);
+    memset(tl->occ, CELL_FREE, CHUNK_CELLS);
+    const obst_map_t *m = g->obst;
+    if (!m || !m->count) {
+        tile_index_free(tl, xn, yn);
+        return;
+    }
+
+    size_t last = ((size_t)m->w * (size_t)m->h - 1) >> 3;
+    for (int y = 0; y < yn; y++) {
+        uint8_t *row = tl->occ + (y << CHUNK_SHIFT);
+        size_t i = (size_t)(y0 + y) * (size_t)m->w + (size_t)x0;
+        for (int x = 0; x < xn; x += 8, i += 8) {
+            size_t k = i >> 3;
+            unsigned b = m->bits[k] | (k < last ? (unsigned)m->bits[k + 1] << 8 : 0u);
+            uint64_t v = spread_bits((b >> (i & 7)) & 0xFF);
+            memcpy(row + x, &v, (size_t)(xn - x < 8 ? xn - x : 8));
+        }
+    }
+    tile_index_free(tl, xn, yn);
+}
+
+/* ===================== voľné bunky ===================== */
+
+static int ntiles(const game_t *g) {
+    return g->tiles_w * g->tiles_h;
+}
+
+static void tree_add(game_t *g, int t, int d) {
+    for (int i = t + 1; i <= ntiles(g); i += i & -i) g->free_tree[i] += d;
+}
+
+// tile_free -> strom v O(dlaždíc)
+static void tree_build(game_t *g) {
+    int n = ntiles(g);
+    for (int i = 1; i <= n; i++) g->free_tree[i] = g->tile_free[i - 1];
+    for (int i = 1; i <= n; i++) {
+        int j = i + (i & -i);
+        if (j <= n) g->free_tree[j] += g->free_tree[i];
+    }
+}
+
+// dlaždica, v ktorej leží k-ta voľná bunka (0-based); *k = poradie v nej
+static int tree_find(const game_t *g, int32_t *k) {
+    int n = ntiles(g), pos = 0;
+    int step = 1;
+    while (step * 2 <= n) step *= 2;
+    for (; step > 0; step >>= 1) {
+        if (pos + step <= n && g->free_tree[pos + step] <= *k) {
+            pos += step;
+            *k -= g->free_tree[pos];
+        }
+    }
+    return pos;
+}
+
+// voľné bunky dlaždíc bez hadov; prepočíta sa len pri inej doske alebo mape
+static void count_base(game_t *g) {
+    int n = ntiles(g);
+    for (int t = 0; t < n; t++) {
+        int x0, y0, xn, yn;
+        tile_extent(g, t, &x0, &y0, &xn, &yn);
+        int32_t c = xn * yn;
+        if (g->obst && g->obst->count) {
+            for (int y = y0; y < y0 + yn; y++)
+                for (int x = x0; x < x0 + xn; x++) c -= obst_cell(g->obst, x, y);
+        }
+        g->tile_base[t] = c;
+    }
+    g->base_obst = g->obst;
+    g->base_w = g->w;
+    g->base_h = g->h;
+}
+
+// k-ta voľná bunka dlaždice bez pamäte (len prekážky), v rámci dlaždice
+static void tile_kth_free(const game_t *g, int t, int32_t k, int *fx, int *fy) {
+    int x0, y0, xn, yn;
+    tile_extent(g, t, &x0, &y0, &xn, &yn);
+    if (g->tile_base[t] == xn * yn) {
+        *fx = x0 + k % xn;
+        *fy = y0 + k / xn;
+        return;
+    }
+    for (int y = y0; y < y0 + yn; y++) {
+        for (int x = x0; x < x0 + xn; x++) {
+            if (obst_cell(g->obst, x, y) || k-- > 0) continue;
+            *fx = x;
+            *fy = y;
+            return;
+        }
+    }
+}
+
+// dlaždica na zápis, vznikne z prekážok alebo prázdna; NULL bez pamäte
+static tile_t *tile_get(game_t *g, int x, int y) {
+    int t = tile_index(g, x, y);
+    if (g->tiles[t]) return g->tiles[t];
+
+    tile_t *tl = (tile_t *)malloc(sizeof(*tl));
+    if (!tl) return NULL;
+    tile_fill(g, t, tl);
+    g->tiles[t] = tl;
+    return tl;
+}
+
+// Dlaždica už musí existovať (tile_get pred prvým zápisom). occ, zoznam
+// voľných v dlaždici a počty sa menia vždy spolu.
+static void cell_set(game_t *g, int x, int y, uint8_t v) {
+    int t = tile_index(g, x, y);
+    int o = tile_offset(x, y);
+    tile_t *tl = g->tiles[t];
+    if (tl->occ[o] == CELL_FREE && v != CELL_FREE) {
+        int i = tl->free_pos[o];
+        uint16_t last = tl->free_cells[--tl->free_len];
+        tl->free_cells[i] = last;
+        tl->free_pos[last] = (uint16_t)i;
+        g->tile_free[t]--;
+        tree_add(g, t, -1);
+        g->free_count--;
+    } else if (tl->occ[o] != CELL_FREE && v == CELL_FREE) {
+        tl->free_pos[o] = (uint16_t)tl->free_len;
+        tl->free_cells[tl->free_len++] = (uint16_t)o;
+        g->tile_free[t]++;
+        tree_add(g, t, 1);
+        g->free_count++;
+    }
+    tl->occ[o] = v;
+}
+
+/* ===================== hady ===================== */
+
+msg_point_t game_snake_get(const game_t *g, int snake, int i) {
+    const snake_t *s = &g->snakes[snake];
+    int j = s->head_idx + i;
+    if (j >= s->cap) j -= s->cap;
+    return s->buf[j];
+}
+
+void game_snake_copy(const game_t *g, int snake, msg_point_t *out) {
+    const snake_t *s = &g->snakes[snake];
+    int first = s->cap - s->head_idx;
+    if (first > s->len) first = s->len;
+    memcpy(out, s->buf + s->head_idx, (size_t)first * sizeof(msg_point_t));
+    memcpy(out + first, s->buf, (size_t)(s->len - first) * sizeof(msg_point_t));
+}
+
+// výrez neprechádza cez wrap, pri okraji sa posunie dnu
+static void view_axis(int c, int v, int side, int32_t *from, int32_t *len) {
+    if (v <= 0 || v >= side) { *from = 0; *len = side; return; }
+    int f = c - v / 2;
+    if (f + v > side) f = side - v;
+    if (f < 0) f = 0;
+    *from = f;
+    *len = v;
+}
+
+msg_rect_t game_view(const game_t *g, int cx, int cy, int vw, int vh) {
+    msg_rect_t r;
+    view_axis(cx, vw, g->w, &r.x, &r.w);
+    view_axis(cy, vh, g->h, &r.y, &r.h);
+    return r;
+}
+
+// vzdialenosť c od intervalu [from, from + len) na kruhu so side bunkami
+static int ring_gap(int c, int from, int len, int side) {
+    int d = c - from;
+    if (d < 0) d += side;
+    if (d < len) return 0;
+    int before = side - d;            // k začiatku intervalu ďalej po kruhu
+    int after = d - (len - 1);        // od konca intervalu
+    return before < after ? before : after;
+}
+
+int game_snake_clip(const game_t *g, int snake, msg_rect_t r, msg_point_t *out, int *head) {
+    const snake_t *s = &g->snakes[snake];
+    *head = 0;
+    if (s->len == 0) return 0;
+
+    if (r.x == 0 && r.y == 0 && r.w == g->w && r.h == g->h) {
+        game_snake_copy(g, snake, out);
+        *head = 1;
+        return s->len;
+    }
+
+    // k-ty bod je od hlavy najviac k krokov, aj cez wrap: vzdialený
+    // had sa vôbec neprechádza
+    msg_point_t hp = game_snake_get(g, snake, 0);
+    if (ring_gap(hp.x, r.x, r.w, g->w) + ring_gap(hp.y, r.y, r.h, g->h) >= s->len) return 0;
+
+    // ring po dvoch súvislých úsekoch, bod sa zapíše vždy a n sa posunie
+    // len ak je vnútri (bez skokov, telo často strieda vnútri a vonku)
+    *head = (unsigned)(hp.x - r.x) < (unsigned)r.w && (unsigned)(hp.y - r.y) < (unsigned)r.h;
+    int n = 0;
+    int first = s->cap - s->head_idx;
+    if (first > s->len) first = s->len;
+    const msg_point_t *seg[2] = {s->buf + s->head_idx, s->buf};
+    int seg_len[2] = {first, s->len - first};
+    for (int k = 0; k < 2; k++) {
+        for (int i = 0; i < seg_len[k]; i++) {
+            msg_point_t p = seg[k][i];
+            out[n] = p;
+            n += (unsigned)(p.x - r.x) < (unsigned)r.w && (unsigned)(p.y - r.y) < (unsigned)r.h;
+        }
+    }
+    return n;
+}
+
+// miesto aspoň pre n bodov; ring sa pri raste narovná od hlavy
+static int snake_reserve(game_t *g, int i, int n) {
+    snake_t *s = &g->snakes[i];
+    if (n <= s->cap) return 0;
+
+    int cap = s->cap ? s->cap * 2 : SNAKE_CAP0;
+    if (cap < n) cap = n;
+    msg_point_t *buf = (msg_point_t *)malloc((size_t)cap * sizeof(msg_point_t));
+    if (!buf) return -1;
+    if (s->buf) game_snake_copy(g, i, buf);
+    free(s->buf);
+    s->buf = buf;
+    s->cap = cap;
+    s->head_idx = 0;
+    return 0;
+}
+
+static void snake_set_head(game_t *g, int i, msg_point_t p) {
+    snake_t *s = &g->snakes[i];
+    s->head_idx = (s->head_idx == 0) ? s->cap - 1 : s->head_idx - 1;
+    s->buf[s->head_idx] = p;
+    cell_set(g, p.x, p.y, (uint8_t)(CELL_SNAKE + i));
+    s->pushes++;
+}
+
+static void snake_drop_tail(game_t *g, int i) {
+    snake_t *s = &g->snakes[i];
+    msg_point_t t = game_snake_get(g, i, s->len - 1);
+    cell_set(g, t.x, t.y, CELL_FREE);
+    s->pops++;
+}
+
+// celé telo z dosky preč
+static void snake_clear(game_t *g, int i) {
+    snake_t *s = &g->snakes[i];
+    for (int k = 0; k < s->len; k++) {
+        msg_point_t p = game_snake_get(g, i, k);
+        cell_set(g, p.x, p.y, CELL_FREE);
+    }
+    s->len = 0;
+    s->alive = 0;
+}
+
+/* ===================== doska ===================== */
+
+static void free_tile_grid(void **grid, int n) {
+    if (!grid) return;
+    for (int i = 0; i < n; i++) free(grid[i]);
+    free(grid);
+}
+
+static void free_board(game_t *g) {
+    free_tile_grid((void **)g->tiles, g->tiles_w * g->tiles_h);
+    free(g->tile_free);
+    free(g->tile_base);
+    free(g->free_tree);
+    g->tiles = NULL;
+    g->tile_free = g->tile_base = g->free_tree = NULL;
+    g->base_obst = NULL;
+    g->tiles_w = g->tiles_h = 0;
+}
+
+void game_init(game_t *g) {
+    memset(g, 0, sizeof(*g));
+    g->mode = MODE_STANDARD;
+    g->duration_s = 60;
+    g->world_type = WORLD_WRAP;
+    g->w = 20;
+    g->h = 15;
+    g->rng = 1;
+    g->snakes[0].used = 1;
+    g->nsnakes = 1;
+}
+
+void game_seed(game_t *g, uint64_t seed) {
+    g->rng = seed;
+}
+
+void game_free(game_t *g) {
+    g->obst = NULL;
+    free_board(g);
+    for (int i = 0; i < MAX_SNAKES; i++) {
+        free(g->snakes[i].buf);
+        g->snakes[i].buf = NULL;
+        g->snakes[i].cap = 0;
+    }
+}
+
+int game_set_obstacles(game_t *g, const obst_map_t *m) {
+    if (m && (m->w != g->w || m->h != g->h)) return -1;
+    g->obst = m;
+    return 0;
+}
+
+static int ensure_buffers(game_t *g) {
+    // prekážky pre inú dosku alebo svet bez prekážok, pred count_base
+    if (g->obst && (g->world_type != WORLD_OBSTACLES || g->obst->w != g->w || g->obst->h != g->h))
+        g->obst = NULL;
+
+    int tw = tiles_for(g->w);
+    int th = tiles_for(g->h);
+    if (!g->tiles || g->tiles_w != tw || g->tiles_h != th) {
+        free_board(g);
+        size_t n = (size_t)tw * (size_t)th;
+        g->tiles = (tile_t **)calloc(n, sizeof(tile_t *));
+        g->tile_free = (int32_t *)malloc(n * sizeof(int32_t));
+        g->tile_base = (int32_t *)malloc(n * sizeof(int32_t));
+        g->free_tree = (int32_t *)malloc((n + 1) * sizeof(int32_t));
+        if (!g->tiles || !g->tile_free || !g->tile_base || !g->free_tree) {
+            free_board(g);
+            return -1;
+        }
+        g->tiles_w = tw;
+        g->tiles_h = th;
+        count_base(g);
+    }
+    // aj pri rovnakom počte dlaždíc sa mení rozsah krajných
+    if (g->base_obst != g->obst || g->base_w != g->w || g->base_h != g->h) count_base(g);
+
+    for (int i = 0; i < g->nsnakes; i++) {
+        if (g->snakes[i].used && snake_reserve(g, i, SNAKE_CAP0) != 0) return -1;
+    }
+    return 0;
+}
+
+// existujúce dlaždice späť na prekážky, nič sa neuvoľňuje
+static void clear_cells(game_t *g) {
+    int n = g->tiles_w * g->tiles_h;
+    for (int t = 0; t < n; t++) {
+        if (g->tiles[t]) tile_fill(g, t, g->tiles[t]);
+    }
+    memcpy(g->tile_free, g->tile_base, (size_t)n * sizeof(int32_t));
+    tree_build(g);
+    g->free_count = (int64_t)g->w * g->h - (g->obst ? g->obst->count : 0);
+}
+
+// Rovnomerne z voľných buniek: k-ta voľná určí dlaždicu cez strom
+// (O(log dlaždíc)), v existujúcej dlaždici je bunka priamo v zozname
+// voľných (O(1)). Dlaždica bez pamäte má len prekážky, tam sa bunka
+// dopočíta v rámci dlaždice.
+static void spawn_fruit(game_t *g) {
+    if (g->free_count <= 0) {
+        g->fruit_x = g->fruit_y = -1;
+        g->gameover = GAMEOVER_WON;
+        return;
+    }
+
+    int32_t k = (int32_t)((next_rand(g) >> 1) % (uint64_t)g->free_count);
+    int t = tree_find(g, &k);
+    const tile_t *tl = g->tiles[t];
+    if (tl) {
+        int o = tl->free_cells[k];
+        g->fruit_x = ((t % g->tiles_w) << CHUNK_SHIFT) | (o & (CHUNK - 1));
+        g->fruit_y = ((t / g->tiles_w) << CHUNK_SHIFT) | (o >> CHUNK_SHIFT);
+        return;
+    }
+    tile_kth_free(g, t, k, &g->fruit_x, &g->fruit_y);
+}
+
+static int wrap_x(const game_t *g, int x) {
+    if (x < 0) return x + g->w;
+    if (x >= g->w) return x - g->w;
+    return x;
+}
+
+// had dĺžky SPAWN_LEN smerom doprava, hlava na (cx, cy); -1 bez pamäte
+static int place_snake(game_t *g, int i, int cx, int cy) {
+    for (int k = 0; k < SPAWN_LEN; k++)
+        if (!tile_get(g, wrap_x(g, cx - k), cy)) return -1;
+    if (snake_reserve(g, i, SPAWN_LEN) != 0) return -1;
+
+    snake_t *s = &g->snakes[i];
+    s->dir = DIR_RIGHT;
+    s->turn_len = 0;
+    s->grow_pending = 0;
+    s->head_idx = 0;
+    s->len = SPAWN_LEN;
+    s->alive = 1;
+    for (int k = 0; k < SPAWN_LEN; k++) {
+        int x = wrap_x(g, cx - k);
+        s->buf[k] = (msg_point_t){(int16_t)x, (int16_t)cy};
+        cell_set(g, x, cy, (uint8_t)(CELL_SNAKE + i));
+    }
+    return 0;
+}
+
+// voľná bunka (x + dx, y) bez ovocia, vrátane wrap; mimo dosky nie je voľná
+static int free_at(const game_t *g, int x, int dx, int y) {
+    x += dx;
+    if (x < 0 || x >= g->w) {
+        if (g->world_type != WORLD_WRAP) return 0;
+        x = wrap_x(g, x);
+    }
+    return game_cell(g, x, y) == CELL_FREE && !(x == g->fruit_x && y == g->fruit_y);
+}
+
+// aréna: náhodné voľné miesto s voľnou bunkou pred hlavou
+static int spawn_random(game_t *g, int i) {
+    for (int t = 0; t < SPAWN_TRIES && g->free_count > SPAWN_LEN; t++) {
+        int x = rand_range(g, 0, g->w - 1);
+        int y = rand_range(g, 0, g->h - 1);
+        if (!free_at(g, x, 0, y) || !free_at(g, x, 1, y) || !free_at(g, x, -1, y) || !free_at(g, x, -2, y)) continue;
+        return place_snake(g, i, x, y);
+    }
+    return -1;
+}
+
+static int obst_at(const game_t *g, int x, int y) {
+    if (x < 0 || x >= g->w || y < 0 || y >= g->h) return 1;
+    return game_cell(g, x, y) == CELL_OBST;
+}
+
+// prvý voľný štart mapy od náhodného, 0 ak žiadny nie je voľný
+static int map_spawn(game_t *g, int *cx, int *cy) {
+    const obst_map_t *m = g->obst;
+    if (!m || m->nspawns == 0) return 0;
+    int k0 = rand_range(g, 0, m->nspawns - 1);
+    for (int k = 0; k < m->nspawns; k++) {
+        msg_point_t p = m->spawns[(k0 + k) % m->nspawns];
+        if (obst_at(g, p.x, p.y) || obst_at(g, p.x - 1, p.y) || obst_at(g, p.x - 2, p.y)) continue;
+        *cx = p.x;
+        *cy = p.y;
+        return 1;
+    }
+    return 0;
+}
+
+// bežná hra: štart z mapy, inak stred dosky, pri prekážkach náhodné miesto
+static int spawn_center(game_t *g, int i) {
+    int cx = g->w / 2;
+    int cy = g->h / 2;
+
+    if (g->world_type == WORLD_OBSTACLES && !map_spawn(g, &cx, &cy)) {
+        int tries = 0;
+        while (tries < 5000 && (obst_at(g, cx, cy) || obst_at(g, cx - 1, cy) || obst_at(g, cx - 2, cy))) {
+            cx = rand_range(g, 2, g->w - 2);
+            cy = rand_range(g, 1, g->h - 2);
+            tries++;
+        }
+    }
+    return place_snake(g, i, cx, cy);
+}
+
+int game_reset(game_t *g, int64_t now_ns) {
+    if (ensure_buffers(g) != 0) return -1;
+
+    g->paused = 0;
+    g->pause_start_ns = 0;
+    g->paused_total_ns = 0;
+    g->gameover = GAMEOVER_NONE;
+    g->fruit_x = g->fruit_y = -1;
+
+    clear_cells(g);
+    for (int i = 0; i < g->nsnakes; i++) {
+        snake_t *s = &g->snakes[i];
+        if (!s->used) continue;
+        s->score = 0;
+        s->len = 0;
+        s->alive = 0;
+        if (g->arena) (void)spawn_random(g, i);
+        else if (spawn_center(g, i) != 0) return -1;
+    }
+
+    g->now_ns = now_ns;
+    g->start_ns = now_ns;
+    spawn_fruit(g);
+
+    g->epoch++;
+    g->active = 1;
+    return 0;
+}
+
+int game_add_snake(game_t *g) {
+    int i = 0;
+    while (i < MAX_SNAKES && g->snakes[i].used) i++;
+    if (i == MAX_SNAKES) return -1;
+
+    snake_t *s = &g->snakes[i];
+    free(s->buf);
+    memset(s, 0, sizeof(*s));
+    s->used = 1;
+    if (i >= g->nsnakes) g->nsnakes = i + 1;
+
+    if (g->active) {
+        if (snake_reserve(g, i, SNAKE_CAP0) != 0) {
+            game_remove_snake(g, i);
+            return -1;
+        }
+        (void)spawn_random(g, i); // bez miesta ostane mŕtvy, game_respawn skúsi znova
+    }
+    return i;
+}
+
+void game_remove_snake(game_t *g, int snake) {
+    snake_t *s = &g->snakes[snake];
+    if (!s->used) return;
+    if (s->alive && g->tiles) snake_clear(g, snake);
+    free(s->buf);
+    memset(s, 0, sizeof(*s));
+    while (g->nsnakes > 0 && !g->snakes[g->nsnakes - 1].used) g->nsnakes--;
+}
+
+int game_respawn(game_t *g, int snake) {
+    snake_t *s = &g->snakes[snake];
+    if (!g->active || !s->used || s->alive) return -1;
+    s->score = 0;
+    return spawn_random(g, snake);
+}
+
+int64_t game_elapsed_ns(const game_t *g) {
+    int64_t now = g->now_ns;
+    int64_t paused = g->paused_total_ns;
+    if (g->paused && g->pause_start_ns != 0) paused += now - g->pause_start_ns;
+
+    int64_t e = now - g->start_ns - paused;
+    return e < 0 ? 0 : e;
+}
+
+int game_elapsed_s(const game_t *g) {
+    return (int)(game_elapsed_ns(g) / NS_PER_S);
+}
+
+static int64_t time_left_ns(const game_t *g) {
+    int64_t left = (int64_t)g->duration_s * NS_PER_S - game_elapsed_ns(g);
+    return left < 0 ? 0 : left;
+}
+
+int game_time_left_s(const game_t *g) {
+    if (g->mode != MODE_TIMED) return -1;
+    return (int)((time_left_ns(g) + NS_PER_S - 1) / NS_PER_S);
+}
+
+void game_toggle_pause(game_t *g, int64_t now_ns) {
+    if (g->gameover) return;
+    if (now_ns > g->now_ns) g->now_ns = now_ns;
+    if (!g->paused) {
+        g->paused = 1;
+        g->pause_start_ns = g->now_ns;
+    } else {
+        g->paused = 0;
+        if (g->pause_start_ns != 0) {
+            int64_t d = g->now_ns - g->pause_start_ns;
+            if (d > 0) g->paused_total_ns += d;
+            g->pause_start_ns = 0;
+        }
+    }
+}
+
+void game_queue_turn(game_t *g, int snake, dir_t d) {
+    if (snake < 0 || snake >= g->nsnakes) return;
+    snake_t *s = &g->snakes[snake];
+    if (d < DIR_UP || d > DIR_RIGHT) return;
+    if (s->turn_len == TURN_QUEUE) return;
+    s->turns[s->turn_len++] = d;
+}
+
+// prvá otočka, ktorá niečo mení; protismerné a rovnaké sa preskočia
+static void apply_turn(snake_t *s) {
+    while (s->turn_len > 0) {
+        dir_t nd = s->turns[0];
+        s->turn_len--;
+        memmove(s->turns, s->turns + 1, (size_t)s->turn_len * sizeof(dir_t));
+        if (nd == s->dir || (s->len > 1 && is_opposite(s->dir, nd))) continue;
+        s->dir = nd;
+        return;
+    }
+}
+
+// bunka, na ktorú ide hlava; 0 pri náraze do okraja
+static int next_head(const game_t *g, int i, msg_point_t *out) {
+    const snake_t *s = &g->snakes[i];
+    msg_point_t h = game_snake_get(g, i, 0);
+    int nx = h.x, ny = h.y;
+
+    if (s->dir == DIR_UP) ny--;
+    else if (s->dir == DIR_DOWN) ny++;
+    else if (s->dir == DIR_LEFT) nx--;
+    else if (s->dir == DIR_RIGHT) nx++;
+
+    if (g->world_type == WORLD_WRAP) {
+        if (nx < 0) nx = g->w - 1;
+        else if (nx >= g->w) nx = 0;
+        if (ny < 0) ny = g->h - 1;
+        else if (ny >= g->h) ny = 0;
+    } else if (nx < 0 || nx >= g->w || ny < 0 || ny >= g->h) {
+        return 0;
+    }
+    *out = (msg_point_t){(int16_t)nx, (int16_t)ny};
+    return 1;
+}
+
+static void kill_snake(game_t *g, int i) {
+    if (!g->arena) {
+        g->gameover = GAMEOVER_LOST; // bežná hra: had ostane ležať na doske
+        return;
+    }
+    snake_clear(g, i);
+}
+
+// Všetky hady naraz: najprv sa zistia ciele hláv, potom zrážky s telami
+// (cez vlastníka v dlaždici, chvost ktorý sa v tomto ticku uvoľní je
+// voľný), potom hlava-hlava porovnaním cieľov (hadov je najviac
+// MAX_SNAKES). Až potom sa doska mení.
+static void step(game_t *g) {
+    msg_point_t target[MAX_SNAKES];
+    uint8_t moves[MAX_SNAKES], dies[MAX_SNAKES], growing[MAX_SNAKES];
+
+    for (int i = 0; i < g->nsnakes; i++) {
+        snake_t *s = &g->snakes[i];
+        moves[i] = s->used && s->alive && s->len > 0;
+        dies[i] = 0;
+        growing[i] = 0;
+        target[i] = (msg_point_t){-1, -1};
+        if (!moves[i]) continue;
+        apply_turn(s);
+        if (s->grow_pending > 0) {
+            // bez pamäte na dlhšie telo had jednoducho nerastie
+            if (snake_reserve(g, i, s->len + 1) == 0) growing[i] = 1;
+            else s->grow_pending = 0;
+        }
+        if (!next_head(g, i, &target[i]) || !tile_get(g, target[i].x, target[i].y)) dies[i] = 1;
+    }
+
+    for (int i = 0; i < g->nsnakes; i++) {
+        if (!moves[i] || dies[i]) continue;
+        int v = game_cell(g, target[i].x, target[i].y);
+        if (v == CELL_FREE) continue;
+        if (v == CELL_OBST) { dies[i] = 1; continue; }
+
+        int j = CELL_OWNER(v);
+        msg_point_t t = game_snake_get(g, j, g->snakes[j].len - 1);
+        int onto_tail = moves[j] && !growing[j] && same_point(t, target[i]);
+        if (!onto_tail) dies[i] = 1;
+    }
+
+    for (int i = 0; i < g->nsnakes; i++) {
+        if (!moves[i]) continue;
+        for (int j = i + 1; j < g->nsnakes; j++) {
+            if (moves[j] && same_point(target[i], target[j])) dies[i] = dies[j] = 1;
+        }
+    }
+
+    for (int i = 0; i < g->nsnakes; i++) {
+        if (!moves[i]) continue;
+        if (dies[i]) kill_snake(g, i);
+        else if (!growing[i]) snake_drop_tail(g, i);
+    }
+    if (g->gameover) return;
+
+    int ate = 0;
+    for (int i = 0; i < g->nsnakes; i++) {
+        if (!moves[i] || dies[i]) continue;
+        snake_t *s = &g->snakes[i];
+        snake_set_head(g, i, target[i]);
+
+        if (growing[i]) {
+            s->len++;
+            s->grow_pending--;
+        }
+        if (target[i].x == g->fruit_x && target[i].y == g->fruit_y) {
+            s->score += 10;
+            s->grow_pending++;
+            ate = 1;
+        }
+    }
+    if (ate) spawn_fruit(g);
+}
+
+void game_tick(game_t *g, int64_t now_ns) {
+    if (!g->active) return;
+    if (now_ns > g->now_ns) g->now_ns = now_ns;
+
+    if (!g->gameover && g->mode == MODE_TIMED) {
+        if (time_left_ns(g) == 0) g->gameover = GAMEOVER_LOST;
+    }
+
+    if (!g->paused && !g->gameover) step(g);
+}
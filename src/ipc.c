@@ -1,11 +1,20 @@
+#define _GNU_SOURCE  // memfd_create
 #include "ipc.h"
 
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/un.h>
+#include <time.h>
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 int ipc_server_listen(const char *path) {
     int fd = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -23,7 +32,7 @@ int ipc_server_listen(const char *path) {
         return -1;
     }
 
-    if (listen(fd, 1) < 0) {
+    if (listen(fd, SOMAXCONN) < 0) {
         close(fd);
         return -1;
     }
@@ -31,6 +40,14 @@ int ipc_server_listen(const char *path) {
     return fd;
 }
 
+// socket activation: prvý odovzdaný fd je 3, ak LISTEN_PID sme my
+int ipc_server_activated(void) {
+    const char *pid = getenv("LISTEN_PID");
+    const char *fds = getenv("LISTEN_FDS");
+    if (!pid || !fds || atol(pid) != (long)getpid() || atoi(fds) < 1) return -1;
+    return 3;
+}
+
 int ipc_server_accept(int listen_fd) {
     return accept(listen_fd, NULL, NULL);
 }
@@ -52,6 +69,12 @@ int ipc_client_connect(const char *path) {
     return fd;
 }
 
+int ipc_set_nonblock(int fd) {
+    int fl = fcntl(fd, F_GETFL, 0);
+    if (fl < 0) return -1;
+    return fcntl(fd, F_SETFL, fl | O_NONBLOCK);
+}
+
 int ipc_send_all(int fd, const void *buf, size_t n) {
     const char *p = buf;
     while (n > 0) {
@@ -73,3 +96,173 @@ int ipc_recv_all(int fd, void *buf, size_t n) {
     }
     return 0;
 }
+
+ssize_t ipc_frame_parse(const void *buf, size_t n, size_t max_len, msg_hdr_t *h, const unsigned char **payload) {
+    if (n < sizeof(*h)) return 0;
+    memcpy(h, buf, sizeof(*h));
+    if (h->version != PROTO_VERSION || h->len > max_len || h->len > MAX_FRAME_LEN) return -1;
+    if (n - sizeof(*h) < h->len) return 0;
+    *payload = (const unsigned char *)buf + sizeof(*h);
+    return (ssize_t)(sizeof(*h) + h->len);
+}
+
+size_t ipc_cmd_put(void *out, command_t c, int32_t arg) {
+    msg_hdr_t h = msg_hdr(c, sizeof(arg));
+    memcpy(out, &h, sizeof(h));
+    memcpy((unsigned char *)out + sizeof(h), &arg, sizeof(arg));
+    return CMD_FRAME_SIZE;
+}
+
+ssize_t ipc_send_fd(int sock, const void *buf, size_t n, int fd) {
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    struct iovec iov = {(void *)buf, n};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(c), &fd, sizeof(int));
+
+    ssize_t r;
+    do r = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    while (r < 0 && errno == EINTR);
+    return r;
+}
+
+ssize_t ipc_recv_fd(int sock, void *buf, size_t n, int *fd) {
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } ctl;
+    struct iovec iov = {buf, n};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+
+    ssize_t r = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    if (r < 0) return r;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        int got;
+        memcpy(&got, CMSG_DATA(c), sizeof(got));
+        if (*fd >= 0) close(*fd);
+        *fd = got;
+    }
+    return r;
+}
+
+/* ===================== zdieľaná pamäť ===================== */
+
+#define SHM_ALIGN 64
+
+static size_t shm_size(size_t slot_cap) {
+    return sizeof(ipc_shm_t) + SHM_SLOTS * slot_cap;
+}
+
+static unsigned char *shm_slot(const ipc_shm_t *m, int i) {
+    return (unsigned char *)(uintptr_t)m + sizeof(*m) + (size_t)i * m->slot_cap;
+}
+
+static long futex(atomic_uint *addr, int op, unsigned val, const struct timespec *ts) {
+    return syscall(SYS_futex, addr, op, val, ts, NULL, 0);
+}
+
+int ipc_shm_create(size_t slot_cap, ipc_shm_t **out, size_t *size) {
+    slot_cap = (slot_cap + SHM_ALIGN - 1) / SHM_ALIGN * SHM_ALIGN;
+    if (slot_cap > UINT32_MAX) return -1;
+    size_t n = shm_size(slot_cap);
+
+    int fd = memfd_create("pos_snake", MFD_CLOEXEC);
+    if (fd < 0) return -1;
+    if (ftruncate(fd, (off_t)n) != 0) {
+        close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, n, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    // ftruncate dal nuly: žiadny frame, sloty prázdne
+    ipc_shm_t *m = (ipc_shm_t *)p;
+    m->slot_cap = (uint32_t)slot_cap;
+    *out = m;
+    *size = n;
+    return fd;
+}
+
+ipc_shm_t *ipc_shm_map(int fd, size_t *size) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ipc_shm_t)) return NULL;
+    size_t n = (size_t)st.st_size;
+
+    void *p = mmap(NULL, n, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return NULL;
+    ipc_shm_t *m = (ipc_shm_t *)p;
+    if (m->slot_cap == 0 || m->slot_cap > (n - sizeof(*m)) / SHM_SLOTS) {
+        munmap(p, n);
+        return NULL;
+    }
+    *size = n;
+    return m;
+}
+
+void ipc_shm_unmap(ipc_shm_t *m, size_t size) {
+    if (m) munmap(m, size);
+}
+
+void ipc_shm_publish(ipc_shm_t *m, const void *frame, size_t len) {
+    if (len > m->slot_cap) return;
+    unsigned n = atomic_load_explicit(&m->frames, memory_order_relaxed) + 1;
+    ipc_shm_slot_t *s = &m->slot[n % SHM_SLOTS];
+
+    unsigned seq = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    atomic_store_explicit(&s->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(shm_slot(m, (int)(n % SHM_SLOTS)), frame, len);
+    s->len = (uint32_t)len;
+    atomic_store_explicit(&s->seq, seq + 2, memory_order_release);
+
+    atomic_store_explicit(&m->frames, n, memory_order_release);
+    (void)futex(&m->frames, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+void ipc_shm_close(ipc_shm_t *m) {
+    atomic_store(&m->closed, 1);
+    // aj frames, inak by čitateľ, ktorý closed ešte nevidel, zaspal na futexe
+    atomic_fetch_add(&m->frames, 1);
+    (void)futex(&m->frames, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+int ipc_shm_wait(ipc_shm_t *m, unsigned seen, int timeout_ms) {
+    struct timespec ts = {timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L};
+    return futex(&m->frames, FUTEX_WAIT, seen, timeout_ms >= 0 ? &ts : NULL) == 0 ? 0 : -1;
+}
+
+const unsigned char *ipc_shm_read_begin(const ipc_shm_t *m, ipc_shm_read_t *r) {
+    unsigned n = atomic_load_explicit(&m->frames, memory_order_acquire);
+    if (n == 0) return NULL;
+    r->slot = (int)(n % SHM_SLOTS);
+    r->seq = atomic_load_explicit(&m->slot[r->slot].seq, memory_order_acquire);
+    if (r->seq & 1) return NULL;
+    r->len = m->slot[r->slot].len;
+    if (r->len > m->slot_cap) return NULL;
+    return shm_slot(m, r->slot);
+}
+
+int ipc_shm_read_ok(const ipc_shm_t *m, const ipc_shm_read_t *r) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&m->slot[r->slot].seq, memory_order_relaxed) == r->seq;
+}
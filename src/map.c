@@ -0,0 +1,337 @@
+#define _DEFAULT_SOURCE
+
+#include "map.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+_Static_assert(sizeof(map_file_t) == 24, "map_file_t must match the file layout");
+
+static size_t grid_bytes(int w, int h) {
+    return ((size_t)w * (size_t)h + 7) / 8;
+}
+
+// FNV-1a
+static uint64_t hash_bytes(uint64_t h, const void *p, size_t n) {
+    const uint8_t *b = (const uint8_t *)p;
+    for (size_t i = 0; i < n; i++) {
+        h ^= b[i];
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static uint64_t map_hash(const obst_map_t *o) {
+    uint64_t h = hash_bytes(0xCBF29CE484222325ULL, o->spawns, (size_t)o->nspawns * sizeof(msg_point_t));
+    return hash_bytes(h, o->bits, grid_bytes(o->w, o->h));
+}
+
+static int count_bits(const obst_map_t *o) {
+    int n = 0;
+    for (int y = 0; y < o->h; y++)
+        for (int x = 0; x < o->w; x++) n += obst_cell(o, x, y);
+    return n;
+}
+
+static int size_ok(int w, int h) {
+    return w >= MIN_W && w <= MAX_WORLD && h >= MIN_H && h <= MAX_WORLD;
+}
+
+static int spawns_ok(const obst_map_t *o) {
+    for (int i = 0; i < o->nspawns; i++) {
+        msg_point_t p = o->spawns[i];
+        if (p.x < 0 || p.x >= o->w || p.y < 0 || p.y >= o->h) return 0;
+    }
+    return 1;
+}
+
+/* ===================== textová mapa ===================== */
+
+static char *read_text(const char *path, size_t *len) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+
+    size_t cap = 4096, n = 0;
+    char *buf = (char *)malloc(cap + 1);
+    while (buf) {
+        n += fread(buf + n, 1, cap - n, f);
+        if (n < cap) break;
+        char *p = (char *)realloc(buf, cap * 2 + 1);
+        if (!p) { free(buf); buf = NULL; break; }
+        buf = p;
+        cap *= 2;
+    }
+    fclose(f);
+    if (buf) buf[n] = '\0';
+    *len = n;
+    return buf;
+}
+
+map_t *map_load_text(const char *path) {
+    size_t len;
+    char *text = read_text(path, &len);
+    if (!text) return NULL;
+
+    // rozmer: najdlhší riadok x počet riadkov, spawny
+    int w = 0, h = 0, nspawns = 0;
+    for (const char *p = text; *p;) {
+        const char *e = strchr(p, '\n');
+        size_t n = e ? (size_t)(e - p) : strlen(p);
+        if (n > 0 && p[n - 1] == '\r') n--;
+        if ((int)n > w) w = (int)n;
+        for (size_t i = 0; i < n; i++) nspawns += p[i] == 'S';
+        h++;
+        p += e ? (size_t)(e - p) + 1 : strlen(p);
+    }
+    if (!size_ok(w, h) || nspawns > MAX_MAP_SPAWNS) { free(text); return NULL; }
+
+    map_t *m = (map_t *)calloc(1, sizeof(*m));
+    size_t sp = (size_t)nspawns * sizeof(msg_point_t);
+    uint8_t *mem = (uint8_t *)calloc(1, sp + grid_bytes(w, h));
+    if (!m || !mem) { free(m); free(mem); free(text); return NULL; }
+
+    msg_point_t *spawns = (msg_point_t *)(void *)mem;
+    uint8_t *bits = mem + sp;
+    int y = 0, k = 0, count = 0;
+    for (const char *p = text; *p; y++) {
+        for (int x = 0; p[x] && p[x] != '\n'; x++) {
+            if (p[x] == '#') {
+                size_t i = (size_t)y * (size_t)w + (size_t)x;
+                bits[i >> 3] |= (uint8_t)(1u << (i & 7));
+                count++;
+            } else if (p[x] == 'S') {
+                spawns[k++] = (msg_point_t){(int16_t)x, (int16_t)y};
+            }
+        }
+        const char *e = strchr(p, '\n');
+        p += e ? (size_t)(e - p) + 1 : strlen(p);
+    }
+    free(text);
+
+    m->mem = mem;
+    m->obst = (obst_map_t){w, h, count, bits, spawns, nspawns};
+    m->hash = map_hash(&m->obst);
+    return m;
+}
+
+/* ===================== skompilovaná mapa ===================== */
+
+int map_write(const map_t *m, const char *path) {
+    const obst_map_t *o = &m->obst;
+    map_file_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, MAP_MAGIC, 4);
+    hdr.version = MAP_VERSION;
+    hdr.w = (uint16_t)o->w;
+    hdr.h = (uint16_t)o->h;
+    hdr.nspawns = (uint16_t)o->nspawns;
+    hdr.obst_count = (uint32_t)o->count;
+    hdr.hash = m->hash;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    size_t sp = (size_t)o->nspawns * sizeof(msg_point_t);
+    size_t nb = grid_bytes(o->w, o->h);
+    int ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+             (sp == 0 || fwrite(o->spawns, sp, 1, f) == 1) &&
+             fwrite(o->bits, nb, 1, f) == 1;
+    if (fclose(f) != 0) ok = 0;
+    return ok ? 0 : -1;
+}
+
+// hlavička a dĺžky sedia so súborom, hash a počet prekážok s obsahom
+static int check_file(const void *base, size_t size, obst_map_t *o, uint64_t *hash) {
+    if (size < sizeof(map_file_t)) return -1;
+    map_file_t hdr;
+    memcpy(&hdr, base, sizeof(hdr));
+    if (memcmp(hdr.magic, MAP_MAGIC, 4) != 0 || hdr.version != MAP_VERSION) return -1;
+    if (!size_ok(hdr.w, hdr.h) || hdr.nspawns > MAX_MAP_SPAWNS) return -1;
+
+    size_t sp = (size_t)hdr.nspawns * sizeof(msg_point_t);
+    if (size != sizeof(hdr) + sp + grid_bytes(hdr.w, hdr.h)) return -1;
+
+    const uint8_t *p = (const uint8_t *)base + sizeof(hdr);
+    *o = (obst_map_t){hdr.w, hdr.h, (int)hdr.obst_count, p + sp, (const msg_point_t *)(const void *)p, hdr.nspawns};
+    if (!spawns_ok(o) || map_hash(o) != hdr.hash || count_bits(o) != o->count) return -1;
+    *hash = hdr.hash;
+    return 0;
+}
+
+map_t *map_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) { close(fd); return NULL; }
+
+    size_t size = (size_t)st.st_size;
+    void *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    map_t *m = (map_t *)calloc(1, sizeof(*m));
+    if (!m || check_file(base, size, &m->obst, &m->hash) != 0) {
+        free(m);
+        munmap(base, size);
+        return NULL;
+    }
+    m->base = base;
+    m->size = size;
+    return m;
+}
+
+void map_free(map_t *m) {
+    if (!m) return;
+    if (m->base) munmap(m->base, m->size);
+    free(m->mem);
+    free(m->wire);
+    free(m);
+}
+
+/* ===================== prenos ===================== */
+
+static size_t put_varint(uint8_t *p, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v & 0x7F) | 0x80;
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+int map_build_wire(map_t *m) {
+    const obst_map_t *o = &m->obst;
+    size_t cells = (size_t)o->w * (size_t)o->h;
+    size_t sp = (size_t)o->nspawns * sizeof(msg_point_t);
+    size_t top = sizeof(msg_hdr_t) + sizeof(msg_map_t) + sp;
+    unsigned char *p = (unsigned char *)malloc(top + MAP_RLE_BOUND(cells));
+    if (!p) return -1;
+
+    // behy: voľný, obsadený, voľný, ...
+    uint8_t *rle = p + top;
+    size_t n = 0, run = 0;
+    int cur = CELL_FREE;
+    for (size_t i = 0; i < cells; i++) {
+        int v = (o->bits[i >> 3] >> (i & 7)) & 1;
+        if (v != cur) {
+            n += put_varint(rle + n, run);
+            cur = v;
+            run = 0;
+        }
+        run++;
+    }
+    n += put_varint(rle + n, run);
+
+    msg_hdr_t hdr = msg_hdr(RESP_MAP, (uint32_t)(top - sizeof(msg_hdr_t) + n));
+    msg_map_t mm = {m->hash, o->w, o->h, o->nspawns, (int32_t)n};
+    memcpy(p, &hdr, sizeof(hdr));
+    memcpy(p + sizeof(hdr), &mm, sizeof(mm));
+    if (sp) memcpy(p + sizeof(hdr) + sizeof(mm), o->spawns, sp);
+
+    free(m->wire);
+    m->wire = p;
+    m->wire_len = top + n;
+    return 0;
+}
+
+// behy do prázdnej bitovej mriežky; počet prekážok, -1 ak nesedia s cells
+static int decode_runs(const uint8_t *p, const uint8_t *end, uint8_t *bits, size_t cells) {
+    size_t i = 0;
+    int cur = CELL_FREE, count = 0;
+    while (p < end) {
+        uint64_t run = 0;
+        int shift = 0;
+        do {
+            if (p == end || shift > 28) return -1;
+            run |= (uint64_t)(*p & 0x7F) << shift;
+            shift += 7;
+        } while (*p++ & 0x80);
+        if (run > cells - i) return -1;
+        if (cur == CELL_OBST) {
+            for (size_t k = i; k < i + run; k++) bits[k >> 3] |= (uint8_t)(1u << (k & 7));
+            count += (int)run;
+        }
+        i += run;
+        cur = !cur;
+    }
+    return i == cells ? count : -1;
+}
+
+map_t *map_from_wire(const msg_map_t *hdr, const msg_point_t *spawns, const uint8_t *rle) {
+    if (!size_ok(hdr->w, hdr->h) || hdr->nspawns < 0 || hdr->nspawns > MAX_MAP_SPAWNS) return NULL;
+    size_t cells = (size_t)hdr->w * (size_t)hdr->h;
+    if (hdr->rle_len < 1 || (size_t)hdr->rle_len > MAP_RLE_BOUND(cells)) return NULL;
+
+    map_t *m = (map_t *)calloc(1, sizeof(*m));
+    size_t sp = (size_t)hdr->nspawns * sizeof(msg_point_t);
+    uint8_t *mem = (uint8_t *)calloc(1, sp + grid_bytes(hdr->w, hdr->h));
+    if (!m || !mem) { free(m); free(mem); return NULL; }
+    if (sp) memcpy(mem, spawns, sp);
+    m->mem = mem;
+
+    uint8_t *bits = mem + sp;
+    int count = decode_runs(rle, rle + hdr->rle_len, bits, cells);
+    m->obst = (obst_map_t){hdr->w, hdr->h, count, bits, (const msg_point_t *)(void *)mem, hdr->nspawns};
+    if (count < 0 || !spawns_ok(&m->obst)) { map_free(m); return NULL; }
+
+    m->hash = map_hash(&m->obst);
+    if (m->hash != hdr->hash) { map_free(m); return NULL; }
+    return m;
+}
+
+/* ===================== katalóg ===================== */
+
+int map_catalog_load(map_catalog_t *c, const char *list) {
+    memset(c, 0, sizeof(*c));
+    FILE *f = fopen(list, "r");
+    if (!f) return -1;
+
+    // súbory máp sú relatívne k adresáru zoznamu
+    const char *slash = strrchr(list, '/');
+    int dir_len = slash ? (int)(slash - list) + 1 : 0;
+
+    char line[512];
+    while (c->n < MAX_MAPS && fgets(line, (int)sizeof(line), f)) {
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char name[MAP_NAME], file[256];
+        if (sscanf(line, "%31s %255s", name, file) != 2) continue;
+
+        char path[512];
+        if (file[0] == '/') snprintf(path, sizeof(path), "%s", file);
+        else snprintf(path, sizeof(path), "%.*s%s", dir_len, list, file);
+
+        map_t *m = map_open(path);
+        if (!m || map_build_wire(m) != 0) {
+            fprintf(stderr, "[map] cannot load %s\n", path);
+            map_free(m);
+            continue;
+        }
+        snprintf(m->name, sizeof(m->name), "%s", name);
+        c->maps[c->n++] = m;
+    }
+    fclose(f);
+    return c->n;
+}
+
+const map_t *map_catalog_get(const map_catalog_t *c, int id) {
+    if (id < 1 || id > c->n) return NULL;
+    return c->maps[id - 1];
+}
+
+const map_t *map_catalog_find(const map_catalog_t *c, uint64_t hash) {
+    for (int i = 0; i < c->n; i++)
+        if (c->maps[i]->hash == hash) return c->maps[i];
+    return NULL;
+}
+
+void map_catalog_free(map_catalog_t *c) {
+    for (int i = 0; i < c->n; i++) map_free(c->maps[i]);
+    c->n = 0;
+}
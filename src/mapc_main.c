@@ -0,0 +1,35 @@
+// Skompiluje textovú mapu do MAP_EXT, ktorú server a nástroje mapujú
+// cez mmap (pozri map.h).
+
+#include "map.h"
+
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s map.txt out" MAP_EXT "\n", argv[0]);
+        return 2;
+    }
+
+    map_t *m = map_load_text(argv[1]);
+    if (!m) {
+        fprintf(stderr, "%s: cannot read or bad map (size %d..%d, at most %d spawns)\n",
+                argv[1], MIN_W, MAX_WORLD, MAX_MAP_SPAWNS);
+        return 1;
+    }
+    if (map_write(m, argv[2]) != 0) {
+        perror(argv[2]);
+        map_free(m);
+        return 1;
+    }
+
+    // kontrola: zapísaný súbor sa dá otvoriť a má ten istý obsah
+    map_t *check = map_open(argv[2]);
+    int ok = check && check->hash == m->hash;
+    printf("%s -> %s: %dx%d, %d obstacles, %d spawns, hash %016llx%s\n",
+           argv[1], argv[2], m->obst.w, m->obst.h, m->obst.count, m->obst.nspawns,
+           (unsigned long long)m->hash, ok ? "" : " (VERIFY FAILED)");
+    map_free(check);
+    map_free(m);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+#include "outq.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void outq_init(outq_t *q) {
+    memset(q, 0, sizeof(*q));
+    pthread_mutex_init(&q->lock, NULL);
+    atomic_init(&q->resync, 0);
+}
+
+void outq_free(outq_t *q) {
+    for (int i = 0; i < OUTQ_MAX; i++) {
+        outq_shared_put(q->frames[i].shared);
+        free(q->frames[i].data);
+    }
+    pthread_mutex_destroy(&q->lock);
+}
+
+// frames[i] sa presunie na koniec medzi rezervné buffre
+static void remove_at(outq_t *q, int i) {
+    outq_frame_t spare = q->frames[i];
+    outq_shared_put(spare.shared);
+    spare.shared = NULL;
+    memmove(&q->frames[i], &q->frames[i + 1], (size_t)(OUTQ_MAX - i - 1) * sizeof(outq_frame_t));
+    spare.len = 0;
+    q->frames[OUTQ_MAX - 1] = spare;
+    q->count--;
+}
+
+// zahodí neodoslané frames okrem riadiacich
+static void coalesce(outq_t *q) {
+    int first = (q->head_off > 0) ? 1 : 0;
+    for (int i = q->count - 1; i >= first; i--) {
+        if (q->frames[i].kind == OUTQ_CTRL) continue;
+        remove_at(q, i);
+        q->dropped++;
+    }
+}
+
+static int flush_locked(outq_t *q, int fd) {
+    while (q->count > 0) {
+        outq_frame_t *f = &q->frames[0];
+        const unsigned char *data = f->shared ? f->shared->data : f->data;
+        ssize_t r = write(fd, data + q->head_off, f->len - q->head_off);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        q->head_off += (size_t)r;
+        if (q->head_off < f->len) continue;
+        q->head_off = 0;
+        remove_at(q, 0);
+    }
+    return 0;
+}
+
+// Pravidlá zahadzovania pre nový frame: 0 ak sa zmestí do frames[count],
+// 1 ak sa snapshot zahodí, -1 ak je fronta plná riadiacich správ.
+static int make_room(outq_t *q, outq_kind_t kind) {
+    if (kind == OUTQ_KEY) coalesce(q);
+    if (q->count < OUTQ_MAX) return 0;
+
+    // riadiaca správa vytlačí všetky neodoslané snapshoty (aj delty za
+    // najstarším, bez neho by nesedeli), ďalší frame musí byť keyframe
+    if (kind == OUTQ_CTRL) {
+        coalesce(q);
+        atomic_store(&q->resync, 1);
+        return (q->count < OUTQ_MAX) ? 0 : -1;
+    }
+
+    // klient nestíha: snapshot sa zahodí, ďalší frame musí byť keyframe
+    atomic_store(&q->resync, 1);
+    q->dropped++;
+    return 1;
+}
+
+int outq_send(outq_t *q, int fd, const void *data, size_t len, outq_kind_t kind) {
+    pthread_mutex_lock(&q->lock);
+
+    int room = make_room(q, kind);
+    if (room != 0) {
+        pthread_mutex_unlock(&q->lock);
+        return (room < 0) ? -1 : 0;
+    }
+
+    outq_frame_t *f = &q->frames[q->count];
+    if (f->cap < len) {
+        unsigned char *p = (unsigned char *)realloc(f->data, len);
+        if (!p) {
+            pthread_mutex_unlock(&q->lock);
+            return -1;
+        }
+        f->data = p;
+        f->cap = len;
+    }
+    memcpy(f->data, data, len);
+    f->len = len;
+    f->kind = kind;
+    q->count++;
+
+    int rc = (fd >= 0) ? flush_locked(q, fd) : 0;
+    pthread_mutex_unlock(&q->lock);
+    return rc;
+}
+
+int outq_send_shared(outq_t *q, int fd, outq_shared_t *b, outq_kind_t kind) {
+    pthread_mutex_lock(&q->lock);
+
+    int room = make_room(q, kind);
+    if (room != 0) {
+        pthread_mutex_unlock(&q->lock);
+        return (room < 0) ? -1 : 0;
+    }
+
+    atomic_fetch_add(&b->refs, 1);
+    outq_frame_t *f = &q->frames[q->count];
+    f->shared = b;
+    f->len = b->len;
+    f->kind = kind;
+    q->count++;
+
+    int rc = (fd >= 0) ? flush_locked(q, fd) : 0;
+    pthread_mutex_unlock(&q->lock);
+    return rc;
+}
+
+outq_shared_t *outq_shared_new(const void *data, size_t len) {
+    outq_shared_t *b = (outq_shared_t *)malloc(sizeof(*b) + len);
+    if (!b) return NULL;
+    atomic_init(&b->refs, 1);
+    b->len = len;
+    memcpy(b->data, data, len);
+    return b;
+}
+
+void outq_shared_put(outq_shared_t *b) {
+    if (b && atomic_fetch_sub(&b->refs, 1) == 1) free(b);
+}
+
+int outq_pending(outq_t *q) {
+    pthread_mutex_lock(&q->lock);
+    int n = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+int outq_flush(outq_t *q, int fd) {
+    pthread_mutex_lock(&q->lock);
+    int rc = flush_locked(q, fd);
+    pthread_mutex_unlock(&q->lock);
+    return rc;
+}
@@ -0,0 +1,187 @@
+#include "replay.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADER_SIZE 31
+
+static void put_varint(FILE *f, uint64_t v) {
+    while (v >= 0x80) {
+        fputc((int)(v & 0x7F) | 0x80, f);
+        v >>= 7;
+    }
+    fputc((int)v, f);
+}
+
+static void put_le(FILE *f, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) fputc((int)((v >> (8 * i)) & 0xFF), f);
+}
+
+recorder_t *rec_open(const char *path, const rec_header_t *h) {
+    recorder_t *r = (recorder_t *)calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->f = fopen(path, "wb");
+    if (!r->f) { free(r); return NULL; }
+
+    fwrite(REC_MAGIC, 1, 4, r->f);
+    fputc(REC_VERSION, r->f);
+    put_le(r->f, h->seed, 8);
+    put_le(r->f, h->map_hash, 8);
+    fputc(h->mode, r->f);
+    fputc(h->world, r->f);
+    put_le(r->f, h->w, 2);
+    put_le(r->f, h->h, 2);
+    put_le(r->f, h->duration_s, 2);
+    put_le(r->f, h->tick_ms, 2);
+    return r;
+}
+
+static void put_record(recorder_t *r, int op) {
+    put_varint(r->f, ((r->tick - r->last) << 3) | (uint64_t)op);
+    r->last = r->tick;
+}
+
+void rec_cmd(recorder_t *r, const msg_cmd_t *cmd) {
+    if (cmd->cmd == CMD_DIR) {
+        if (cmd->arg < DIR_UP || cmd->arg > DIR_RIGHT) return;
+        put_record(r, REC_OP_DIR + cmd->arg - DIR_UP);
+    } else if (cmd->cmd == CMD_TOGGLE_PAUSE) {
+        put_record(r, REC_OP_PAUSE);
+    } else if (cmd->cmd == CMD_RESTART) {
+        put_record(r, REC_OP_RESTART);
+    } else if (cmd->cmd == CMD_SET_TICK) {
+        if (cmd->arg < MIN_TICK_MS || cmd->arg > MAX_TICK_MS) return;
+        put_record(r, REC_OP_SET_TICK);
+        put_varint(r->f, (uint64_t)cmd->arg);
+    }
+}
+
+void rec_tick(recorder_t *r) {
+    r->tick++;
+}
+
+void rec_close(recorder_t *r, const game_t *g) {
+    if (!r) return;
+    const snake_t *sn = &g->snakes[0];
+    put_record(r, REC_OP_END);
+    put_varint(r->f, (uint64_t)sn->score);
+    put_varint(r->f, sn->pushes);
+    put_varint(r->f, sn->pops);
+    fputc(g->gameover, r->f);
+    fclose(r->f);
+    free(r);
+}
+
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const uint8_t *p, *end;
+} cursor_t;
+
+static int get_varint(cursor_t *c, uint64_t *out) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (c->p == c->end) return -1;
+        uint8_t b = *c->p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) { *out = v; return 0; }
+    }
+    return -1;
+}
+
+static uint64_t get_le(cursor_t *c, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint64_t)c->p[i] << (8 * i);
+    c->p += bytes;
+    return v;
+}
+
+static int read_header(cursor_t *c, rec_header_t *h) {
+    if (c->end - c->p < HEADER_SIZE) return -1;
+    if (memcmp(c->p, REC_MAGIC, 4) != 0 || c->p[4] != REC_VERSION) return -1;
+    c->p += 5;
+    h->seed = get_le(c, 8);
+    h->map_hash = get_le(c, 8);
+    h->mode = (uint8_t)get_le(c, 1);
+    h->world = (uint8_t)get_le(c, 1);
+    h->w = (uint16_t)get_le(c, 2);
+    h->h = (uint16_t)get_le(c, 2);
+    h->duration_s = (uint16_t)get_le(c, 2);
+    h->tick_ms = (uint16_t)get_le(c, 2);
+
+    if (h->w < MIN_W || h->w > MAX_WORLD || h->h < MIN_H || h->h > MAX_WORLD) return -1;
+    if (h->world != WORLD_WRAP && h->world != WORLD_OBSTACLES) return -1;
+    if (h->mode != MODE_STANDARD && h->mode != MODE_TIMED) return -1;
+    if (h->tick_ms < MIN_TICK_MS || h->tick_ms > MAX_TICK_MS) return -1;
+    return 0;
+}
+
+int replay_run(const uint8_t *data, size_t len, const map_catalog_t *maps, replay_result_t *out) {
+    cursor_t c = {data, data + len};
+    memset(out, 0, sizeof(*out));
+    rec_header_t *h = &out->hdr;
+    if (read_header(&c, h) != 0) return -1;
+
+    game_t g;
+    game_init(&g);
+    game_seed(&g, h->seed);
+    g.mode = (game_mode_t)h->mode;
+    g.duration_s = h->duration_s;
+    g.world_type = (world_type_t)h->world;
+    g.w = h->w;
+    g.h = h->h;
+
+    if (g.world_type == WORLD_OBSTACLES) {
+        const map_t *m = maps ? map_catalog_find(maps, h->map_hash) : NULL;
+        if (!m || game_set_obstacles(&g, &m->obst) != 0) return -1;
+    }
+
+    // rovnaké poradie ako session_tick + finish_tick na serveri
+    int64_t period = (int64_t)h->tick_ms * 1000000LL;
+    int64_t deadline = period;
+    if (game_reset(&g, 0) != 0) { game_free(&g); return -1; }
+
+    int rc = 0;
+    for (;;) {
+        uint64_t v;
+        if (get_varint(&c, &v) != 0) break;   // truncated log: stop at the last full record
+
+        for (uint64_t k = v >> 3; k > 0; k--) {
+            game_tick(&g, deadline);
+            deadline += period;
+            out->ticks++;
+        }
+        out->events++;
+
+        int op = (int)(v & 7);
+        if (op <= REC_OP_DIR + 3) {
+            game_queue_turn(&g, 0, (dir_t)(DIR_UP + op - REC_OP_DIR));
+        } else if (op == REC_OP_PAUSE) {
+            game_toggle_pause(&g, deadline);
+        } else if (op == REC_OP_RESTART) {
+            (void)game_reset(&g, deadline);
+        } else if (op == REC_OP_SET_TICK) {
+            uint64_t ms;
+            if (get_varint(&c, &ms) != 0) break;
+            if (ms >= MIN_TICK_MS && ms <= MAX_TICK_MS) period = (int64_t)ms * 1000000LL;
+        } else {
+            uint64_t score, pushes, pops;
+            if (get_varint(&c, &score) != 0 || get_varint(&c, &pushes) != 0 ||
+                get_varint(&c, &pops) != 0 || c.p == c.end) { rc = -1; break; }
+            int gameover = *c.p++;
+            out->ended = 1;
+            const snake_t *sn = &g.snakes[0];
+            out->match = (uint64_t)sn->score == score && sn->pushes == pushes &&
+                         sn->pops == pops && g.gameover == gameover;
+            break;
+        }
+    }
+
+    out->sim_ns = deadline - period;
+    out->score = g.snakes[0].score;
+    out->pushes = g.snakes[0].pushes;
+    out->pops = g.snakes[0].pops;
+    out->gameover = g.gameover;
+    game_free(&g);
+    return rc;
+}
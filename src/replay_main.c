@@ -0,0 +1,100 @@
+// Prehrá záznamy zo `server -R dir` cez game_tick bez socketov a čakania
+// a overí, že konečný stav sedí so záznamom.
+
+#define _DEFAULT_SOURCE
+
+#include "game.h"
+#include "map.h"
+#include "replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint8_t *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    size_t cap = 4096, n = 0;
+    uint8_t *buf = (uint8_t *)malloc(cap);
+    while (buf) {
+        n += fread(buf + n, 1, cap - n, f);
+        if (n < cap) break;
+        uint8_t *p = (uint8_t *)realloc(buf, cap * 2);
+        if (!p) { free(buf); buf = NULL; break; }
+        buf = p;
+        cap *= 2;
+    }
+    fclose(f);
+    *len = n;
+    return buf;
+}
+
+static const char *end_state(const replay_result_t *r) {
+    if (!r->ended) return "truncated";
+    return r->match ? "ok" : "MISMATCH";
+}
+
+// 0 ok, 1 mismatch, -1 error
+static int replay_one(const char *path, int repeat, const map_catalog_t *maps) {
+    size_t len = 0;
+    uint8_t *data = read_file(path, &len);
+    if (!data) { perror(path); return -1; }
+
+    replay_result_t r;
+    double t0 = now_ns();
+    for (int i = 0; i < repeat; i++) {
+        if (replay_run(data, len, maps, &r) != 0) {
+            fprintf(stderr, "%s: bad or unsupported log, or its map is not in %s\n", path, MAPS_FILE);
+            free(data);
+            return -1;
+        }
+    }
+    double wall = (now_ns() - t0) / repeat;
+    free(data);
+
+    printf("%s: %s %dx%d %s, %zu bytes, %llu ticks, %llu events, score %d, %s\n",
+           path, r.hdr.world == WORLD_OBSTACLES ? "obstacles" : "wrap", r.hdr.w, r.hdr.h,
+           r.hdr.mode == MODE_TIMED ? "timed" : "standard", len,
+           (unsigned long long)r.ticks, (unsigned long long)r.events, r.score, end_state(&r));
+    if (wall > 0 && r.ticks > 0) {
+        printf("  game time %.1f s, replay %.3f ms (%.1f ns/tick, %.0fx real time)\n",
+               r.sim_ns / 1e9, wall / 1e6, wall / (double)r.ticks, (double)r.sim_ns / wall);
+    }
+    return (r.ended && !r.match) ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    int repeat = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') repeat = atoi(optarg);
+        else {
+            fprintf(stderr, "usage: %s [-n repeat] file" REC_EXT "...\n", argv[0]);
+            return 2;
+        }
+    }
+    if (repeat < 1) repeat = 1;
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-n repeat] file" REC_EXT "...\n", argv[0]);
+        return 2;
+    }
+
+    map_catalog_t maps;
+    (void)map_catalog_load(&maps, MAPS_FILE); // only needed for obstacle worlds
+
+    int rc = 0;
+    for (int i = optind; i < argc; i++) {
+        int r = replay_one(argv[i], repeat, &maps);
+        if (r != 0) rc = 1;
+    }
+    map_catalog_free(&maps);
+    return rc;
+}
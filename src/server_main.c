@@ -1,8 +1,14 @@
+#define _DEFAULT_SOURCE
+
+#include "arena.h"
 #include "ipc.h"
+#include "map.h"
 #include "protocol.h"
+#include "session.h"
+#include "tick_sched.h"
 
 #include <errno.h>
-#include <pthread.h>
+#include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,479 +16,439 @@
 #include <time.h>
 #include <unistd.h>   // close(), unlink()
 
-static void sleep_ms(long ms) {
-    if (ms <= 0) return;
-    struct timespec ts;
-    ts.tv_sec = ms / 1000;
-    ts.tv_nsec = (ms % 1000) * 1000000L;
-    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {}
-}
-
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 
-#define MIN_W 10
-#define MIN_H 10
-#define MAX_W 60
-#define MAX_H 40
-
-#define OB_W 45
-#define OB_H 30
-#define OB_FILE "assets/obstacles_45x30.txt"
-
-#define MIN_TIME 10
-#define MAX_TIME 3600
+#define MAX_EVENTS 64
 
 typedef struct {
-    pthread_mutex_t lock;
     int running;
-
-    int client_fd;        // -1 if no client
-    int session_active;   // 1 if game session is active for current client
-
-    int w, h;
-    world_type_t world_type;
-
-    game_mode_t mode;
-    int duration_s;
-    time_t game_start_ts;
-    time_t pause_start_ts;
-    int paused_total_s;
-
-    msg_point_t *buf;
-    int cap;
-    int head_idx;
-    int len;
-
-    int fruit_x, fruit_y;
-    int score;
-    int paused;
-    int gameover;
-
-    dir_t dir;
-    dir_t requested_dir;
-    int grow_pending;
-
-    uint8_t *obst; // w*h
-} server_state_t;
-
-static int rand_range(int a, int b) { return a + rand() % (b - a + 1); }
-
-static int is_opposite(dir_t a, dir_t b) {
-    return (a == DIR_UP && b == DIR_DOWN) ||
-           (a == DIR_DOWN && b == DIR_UP) ||
-           (a == DIR_LEFT && b == DIR_RIGHT) ||
-           (a == DIR_RIGHT && b == DIR_LEFT);
+    int listen_fd;
+    int epoll_fd;
+    int stats_fd;         // -1 unless -s was given
+    int signal_fd;        // SIGINT/SIGTERM, shut down cleanly
+    int persistent;       // -d: keep running after the last client leaves
+    int idle_fd;          // -i: exit after idle_s without clients, -1 = never
+    int idle_s;
+    const char *rec_dir;  // -R, NULL = no recording
+    map_catalog_t maps;   // MAPS_FILE, mapped once for all sessions
+
+    session_t **bots;     // -b, server-side players without a socket
+    int nbots;
+
+    arena_t *arenas[MAX_ARENAS]; // NULL until the first player joins
+    int arena_bots;       // -A
+    int arena_w, arena_h; // -W
+
+    tick_sched_t sched;
+
+    session_t *sessions[MAX_SESSIONS];
+    int count;
+    int next_id;
+} server_t;
+
+// epoll data.ptr pre listen/stats fd, ostatné ukazujú na session_t
+static int listen_tag;
+static int stats_tag;
+static int idle_tag;
+static int signal_tag;
+
+static int epoll_add(int epfd, int fd, uint32_t events, void *ptr) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = ptr;
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
 }
 
-static int obst_at(const server_state_t *st, int x, int y) {
-    if (!st->obst) return 0;
-    if (x < 0 || x >= st->w || y < 0 || y >= st->h) return 1;
-    return st->obst[y * st->w + x] ? 1 : 0;
+static int start_timer(int tfd, long ms) {
+    struct itimerspec its;
+    its.it_value.tv_sec = ms / 1000;
+    its.it_value.tv_nsec = (ms % 1000) * 1000000L;
+    its.it_interval = its.it_value;
+    return timerfd_settime(tfd, 0, &its, NULL);
 }
 
-static msg_point_t snake_get(const server_state_t *st, int i) {
-    return st->buf[(st->head_idx + i) % st->cap];
+// klienti a boti (-b); server bez nich končí (bez -d) alebo beží idle
+static int live_sessions(const server_t *srv) {
+    return srv->count + srv->nbots;
 }
 
-static void snake_set_head(server_state_t *st, msg_point_t p) {
-    st->head_idx = (st->head_idx - 1 + st->cap) % st->cap;
-    st->buf[st->head_idx] = p;
+// jednorazový idle časovač beží len kým nie je pripojený nikto
+static void arm_idle(server_t *srv) {
+    if (srv->idle_fd < 0) return;
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if (live_sessions(srv) == 0) its.it_value.tv_sec = srv->idle_s;
+    (void)timerfd_settime(srv->idle_fd, 0, &its, NULL);
 }
 
-static int snake_contains(server_state_t *st, msg_point_t p, int allow_tail) {
-    for (int i = 0; i < st->len; i++) {
-        msg_point_t q = snake_get(st, i);
-        if (q.x == p.x && q.y == p.y) {
-            if (allow_tail && i == st->len - 1) return 0;
-            return 1;
-        }
+static void add_session(server_t *srv, int cfd) {
+    if (srv->count >= MAX_SESSIONS) {
+        fprintf(stderr, "[server] session table full, rejecting client\n");
+        close(cfd);
+        return;
     }
-    return 0;
-}
 
-static void free_obstacles(server_state_t *st) {
-    free(st->obst);
-    st->obst = NULL;
-}
-
-static int load_obstacles(server_state_t *st, const char *path) {
-    free_obstacles(st);
+    session_t *s = session_create(++srv->next_id, cfd);
+    if (!s) {
+        perror("calloc");
+        close(cfd);
+        return;
+    }
 
-    size_t n = (size_t)st->w * (size_t)st->h;
-    st->obst = (uint8_t *)calloc(n, 1);
-    if (!st->obst) return -1;
+    // klientske sockety sú neblokujúce a edge-triggered, zápisy idú cez outq
+    if (ipc_set_nonblock(cfd) != 0 ||
+        epoll_add(srv->epoll_fd, cfd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, s) != 0) {
+        perror("epoll_ctl");
+        session_destroy(s);
+        return;
+    }
 
-    FILE *f = fopen(path, "r");
-    if (!f) return -1;
+    s->maps = &srv->maps;
+    s->rec_dir = srv->rec_dir;
+    srv->sessions[srv->count++] = s;
+    if (srv->count == 1) arm_idle(srv);
+    printf("[server] Client connected (session %d, %d active)\n", s->id, srv->count);
+}
 
-    char line[256];
-    for (int y = 0; y < st->h; y++) {
-        if (!fgets(line, (int)sizeof(line), f)) { fclose(f); return -1; }
-        for (int x = 0; x < st->w; x++) st->obst[y * st->w + x] = (line[x] == '#') ? 1 : 0;
+// aréna vznikne s prvým hráčom a zanikne s posledným
+static int join_arena(server_t *srv, session_t *s) {
+    int i = s->cfg.arena - 1;
+    arena_t *a = srv->arenas[i];
+    if (!a) {
+        a = arena_create(i + 1, srv->arena_w, srv->arena_h, srv->arena_bots, (uint64_t)mono_ns());
+        if (!a) return -1;
+        srv->arenas[i] = a;
+        tsched_add(&srv->sched, &a->node);
+        printf("[server] Arena %d created (%dx%d, %d bot(s))\n", a->id, a->game.w, a->game.h, srv->arena_bots);
     }
-    fclose(f);
+    int slot = arena_join(a, s);
+    if (slot < 0) return -1;
+
+    s->state = SESSION_ACTIVE;
+    printf("[server] Session %d joined arena %d as snake %d\n", s->id, a->id, slot);
     return 0;
 }
 
-static void ensure_buffers(server_state_t *st) {
-    int need = st->w * st->h;
-    if (need <= 0) need = 1;
-    if (st->cap != need) {
-        free(st->buf);
-        st->cap = need;
-        st->buf = (msg_point_t *)calloc((size_t)st->cap, sizeof(msg_point_t));
-        if (!st->buf) { perror("calloc"); exit(1); }
-    }
-}
+static void leave_arena(server_t *srv, session_t *s) {
+    arena_t *a = s->arena;
+    if (arena_leave(a, s) > 0) return;
 
-static void spawn_fruit(server_state_t *st) {
-    for (;;) {
-        int x = rand_range(0, st->w - 1);
-        int y = rand_range(0, st->h - 1);
-        if (st->world_type == WORLD_OBSTACLES && obst_at(st, x, y)) continue;
+    tsched_remove(&srv->sched, &a->node);
+    srv->arenas[a->id - 1] = NULL;
+    printf("[server] Arena %d closed\n", a->id);
+    arena_destroy(a);
+}
 
-        int ok = 1;
-        for (int i = 0; i < st->len; i++) {
-            msg_point_t q = snake_get(st, i);
-            if (q.x == x && q.y == y) { ok = 0; break; }
-        }
-        if (ok) { st->fruit_x = x; st->fruit_y = y; return; }
+// vlastná bežiaca hra (hráč alebo bot -b) s daným id, NULL ak nie je
+static session_t *find_game(server_t *srv, int id) {
+    for (int i = 0; i < srv->count; i++) {
+        session_t *t = srv->sessions[i];
+        if (t->id == id) return (t->state == SESSION_ACTIVE && !t->arena) ? t : NULL;
     }
+    for (int i = 0; i < srv->nbots; i++)
+        if (srv->bots[i]->id == id) return srv->bots[i];
+    return NULL;
 }
 
-static void reset_game(server_state_t *st) {
-    ensure_buffers(st);
-
-    st->score = 0;
-    st->paused = 0;
-    st->pause_start_ts = 0;
-    st->paused_total_s = 0;
-    st->gameover = 0;
-    st->grow_pending = 0;
-
-    st->dir = DIR_RIGHT;
-    st->requested_dir = DIR_RIGHT;
-
-    st->len = 3;
-    st->head_idx = 0;
-
-    int cx = st->w / 2;
-    int cy = st->h / 2;
+static int watch_game(server_t *srv, session_t *s) {
+    session_t *t = find_game(srv, s->cfg.watch);
+    if (!t || t == s || session_watch(s, t) != 0) return -1;
+    printf("[server] Session %d watches session %d (%d spectator(s))\n", s->id, t->id, t->nwatchers);
+    return 0;
+}
 
-    if (st->world_type == WORLD_OBSTACLES) {
-        int tries = 0;
-        while (tries < 5000 && (obst_at(st, cx, cy) || obst_at(st, cx - 1, cy) || obst_at(st, cx - 2, cy))) {
-            cx = rand_range(2, st->w - 2);
-            cy = rand_range(1, st->h - 2);
-            tries++;
+static void remove_session(server_t *srv, session_t *s) {
+    for (int i = 0; i < srv->count; i++) {
+        if (srv->sessions[i] == s) {
+            srv->sessions[i] = srv->sessions[--srv->count];
+            break;
         }
     }
-
-    st->buf[0] = (msg_point_t){(int16_t)cx, (int16_t)cy};
-    st->buf[1] = (msg_point_t){(int16_t)(cx - 1), (int16_t)cy};
-    st->buf[2] = (msg_point_t){(int16_t)(cx - 2), (int16_t)cy};
-
-    st->game_start_ts = time(NULL);
-    spawn_fruit(st);
-
-    st->session_active = 1;
+    if (s->arena) leave_arena(srv, s);
+    session_unwatch(s);
+    tsched_remove(&srv->sched, &s->node);
+    int nended;
+    session_t **ended = session_drop_watchers(s, &nended);
+    epoll_ctl(srv->epoll_fd, EPOLL_CTL_DEL, s->fd, NULL);
+    printf("[server] Session %d closed (%d active)\n", s->id, srv->count);
+    session_destroy(s);
+
+    // diváci sa zatvoria po odoslaní BYE: hneď, alebo pri EPOLLOUT
+    for (int i = 0; i < nended; i++)
+        if (outq_pending(&ended[i]->outq) == 0) remove_session(srv, ended[i]);
+    free(ended);
+    if (live_sessions(srv) > 0) return;
+    // bez -d server patrí jednej hre: skončí, keď odíde posledný klient
+    if (!srv->persistent) srv->running = 0;
+    else arm_idle(srv);
 }
 
-static int elapsed_s(const server_state_t *st) {
-    time_t now = time(NULL);
+static void on_stats(server_t *srv) {
+    uint64_t expirations;
+    if (read(srv->stats_fd, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations)) return;
 
-    int extra_pause = 0;
-    if (st->paused && st->pause_start_ts != 0) {
-        extra_pause = (int)difftime(now, st->pause_start_ts);
-        if (extra_pause < 0) extra_pause = 0;
+    for (int i = 0; i < srv->sched.nshards; i++) {
+        shard_stats_t st;
+        tsched_stats(&srv->sched, i, &st, 1);
+        printf("[server] shard %d: sessions %d ticks %llu late %llu stolen %llu lag avg %.3f ms max %.3f ms\n",
+               i, st.sessions, (unsigned long long)st.ticks, (unsigned long long)st.late,
+               (unsigned long long)st.stolen, st.lag_avg_ns / 1e6, st.lag_max_ns / 1e6);
     }
+    fflush(stdout);
+}
 
-    int e = (int)difftime(now, st->game_start_ts) - st->paused_total_s - extra_pause;
-    if (e < 0) e = 0;
-    return e;
+static void on_idle(server_t *srv) {
+    uint64_t expirations;
+    if (read(srv->idle_fd, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations)) return;
+    if (live_sessions(srv) > 0) return;
+    printf("[server] idle for %d s, exiting\n", srv->idle_s);
+    srv->running = 0;
 }
-static int time_left_s(const server_state_t *st) {
-    if (st->mode != MODE_TIMED) return -1;
-    int left = st->duration_s - elapsed_s(st);
-    if (left < 0) left = 0;
-    return left;
+
+// SIGINT/SIGTERM: koniec slučky, session a záznamy sa zatvoria normálne
+static void on_signal(server_t *srv) {
+    struct signalfd_siginfo si;
+    if (read(srv->signal_fd, &si, sizeof(si)) != (ssize_t)sizeof(si)) return;
+    printf("[server] signal %u, shutting down\n", si.ssi_signo);
+    srv->running = 0;
 }
 
-static void send_snapshot_locked(server_state_t *st) {
-    if (!st->session_active) return;
-    if (st->client_fd < 0) return;
-
-    msg_resp_t hdr = {RESP_SNAPSHOT};
-
-    msg_snapshot_t s;
-    s.w = st->w;
-    s.h = st->h;
-    s.score = st->score;
-    s.paused = st->paused;
-    s.gameover = st->gameover;
-    s.fruit_x = st->fruit_x;
-    s.fruit_y = st->fruit_y;
-    s.snake_len = st->len;
-    s.mode = st->mode;
-    s.elapsed_s = elapsed_s(st);
-    s.time_left_s = time_left_s(st);
-
-    (void)ipc_send_all(st->client_fd, &hdr, sizeof(hdr));
-    (void)ipc_send_all(st->client_fd, &s, sizeof(s));
-    for (int i = 0; i < st->len; i++) {
-        msg_point_t p = snake_get(st, i);
-        (void)ipc_send_all(st->client_fd, &p, sizeof(p));
+static void on_accept(server_t *srv) {
+    int cfd = ipc_server_accept(srv->listen_fd);
+    if (cfd < 0) {
+        if (errno != EINTR && errno != EAGAIN) perror("accept");
+        return;
     }
+    add_session(srv, cfd);
 }
 
-static void tick_locked(server_state_t *st) {
-    if (!st->session_active) return;
-
-    dir_t nd = st->requested_dir;
-    if (st->len > 1 && is_opposite(st->dir, nd)) nd = st->dir;
-    st->dir = nd;
+static void on_client(server_t *srv, session_t *s, uint32_t events) {
+    session_rc_t rc = SESSION_OK;
 
-    msg_point_t h = snake_get(st, 0);
-    int nx = h.x, ny = h.y;
+    if (events & EPOLLOUT) rc = session_on_writable(s);
+    if (rc == SESSION_OK && (events & EPOLLIN)) rc = session_on_readable(s);
+    if (rc == SESSION_OK && (events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP))) rc = SESSION_CLOSE;
 
-    if (st->dir == DIR_UP) ny--;
-    else if (st->dir == DIR_DOWN) ny++;
-    else if (st->dir == DIR_LEFT) nx--;
-    else if (st->dir == DIR_RIGHT) nx++;
+    if (rc != SESSION_OK) { remove_session(srv, s); return; }
 
-    if (st->world_type == WORLD_WRAP) {
-        if (nx < 0) nx = st->w - 1;
-        else if (nx >= st->w) nx = 0;
-        if (ny < 0) ny = st->h - 1;
-        else if (ny >= st->h) ny = 0;
-    } else {
-        if (nx < 0 || nx >= st->w || ny < 0 || ny >= st->h) { st->gameover = 1; return; }
-        if (obst_at(st, nx, ny)) { st->gameover = 1; return; }
+    if (s->state == SESSION_AWAIT_CONFIG && (s->cfg.arena > 0 || s->cfg.watch > 0)) {
+        if ((s->cfg.arena > 0 ? join_arena(srv, s) : watch_game(srv, s)) != 0) {
+            msg_hdr_t bye = msg_hdr(RESP_BYE, 0);
+            (void)outq_send(&s->outq, s->fd, &bye, sizeof(bye), OUTQ_CTRL);
+            remove_session(srv, s);
+        }
+        return;
     }
 
-    msg_point_t nh = {(int16_t)nx, (int16_t)ny};
-
-    if (snake_contains(st, nh, st->grow_pending == 0)) { st->gameover = 1; return; }
-
-    snake_set_head(st, nh);
-
-    if (st->grow_pending > 0) {
-        st->len++;
-        st->grow_pending--;
-        if (st->len > st->cap) st->len = st->cap;
+    // konfigurácia je kompletná -> prvý keyframe hneď, nie až po prvom
+    // ticku, a session ide do tick schedulera (hráča v aréne tickuje aréna)
+    if (s->state == SESSION_ACTIVE && !s->arena && atomic_load(&s->node.shard) < 0) {
+        session_send_frame(s);
+        tsched_add(&srv->sched, &s->node);
     }
+}
 
-    if (nx == st->fruit_x && ny == st->fruit_y) {
-        st->score += 10;
-        st->grow_pending++;
-        spawn_fruit(st);
+// boti hrajú 60x40 wrap, každý tretí na mape s prekážkami
+static int spawn_bots(server_t *srv, int n) {
+    srv->bots = (session_t **)calloc((size_t)n, sizeof(*srv->bots));
+    if (!srv->bots) return -1;
+
+    for (int i = 0; i < n; i++) {
+        session_t *s = session_create(++srv->next_id, -1);
+        if (!s) return -1;
+        s->maps = &srv->maps;
+        s->rec_dir = srv->rec_dir;
+
+        int obstacles = (i % 3 == 2);
+        msg_cmd_t cfg[] = {
+            {CMD_SET_MODE, MODE_STANDARD},
+            {CMD_SET_WORLD, obstacles ? WORLD_OBSTACLES : WORLD_WRAP},
+            {CMD_SET_SIZE, (MAX_W << 16) | MAX_H},
+        };
+        for (size_t k = 0; k < sizeof(cfg) / sizeof(cfg[0]); k++) (void)session_on_cmd(s, &cfg[k]);
+
+        if (session_attach_bot(s) != 0) {
+            session_destroy(s);
+            return -1;
+        }
+        srv->bots[srv->nbots++] = s;
+        tsched_add(&srv->sched, &s->node);
     }
+    return 0;
 }
 
-static void *game_thread(void *arg) {
-    server_state_t *st = (server_state_t *)arg;
+// "WxH" pre -W, strany MIN_*..MAX_WORLD
+static int parse_size(const char *s, int *w, int *h) {
+    if (sscanf(s, "%dx%d", w, h) != 2) return -1;
+    if (*w < MIN_W || *w > MAX_WORLD || *h < MIN_H || *h > MAX_WORLD) return -1;
+    return 0;
+}
 
-    while (st->running) {
-        sleep_ms(120);
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [-t threads] [-s stats_seconds] [-R record_dir] [-b bots] [-A arena_bots] [-W arena_WxH]\n"
+                    "       [-d] [-i idle_seconds] [-r ready_fd]\n"
+                    "without -d the server exits when its last client disconnects (quit, menu or lost connection);\n"
+                    "bots (-b) keep it running until SIGINT/SIGTERM\n", argv0);
+}
 
-        pthread_mutex_lock(&st->lock);
+int main(int argc, char **argv) {
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int stats_s = 0;
+    const char *rec_dir = NULL;
+    int nbots = 0;
+    int arena_bots = ARENA_BOTS;
+    int arena_w = ARENA_BOARD_W, arena_h = ARENA_BOARD_H;
+    int persistent = 0;
+    int idle_s = 0;
+    int ready_fd = -1;
+
+    // -d: démon pre viac hier za sebou, bez neho server skončí, keď sa
+    // odpojí posledný klient; -i: démon skončí po idle_s bez klientov,
+    // -r: po štarte zapíše bajt do ready_fd (rúra od toho, kto ho spustil)
+    int opt;
+    while ((opt = getopt(argc, argv, "t:s:R:b:A:W:di:r:")) != -1) {
+        if (opt == 't') threads = atoi(optarg);
+        else if (opt == 's') stats_s = atoi(optarg);
+        else if (opt == 'R') rec_dir = optarg;
+        else if (opt == 'b') nbots = atoi(optarg);
+        else if (opt == 'A') arena_bots = atoi(optarg);
+        else if (opt == 'W') { if (parse_size(optarg, &arena_w, &arena_h) != 0) { usage(argv[0]); return 1; } }
+        else if (opt == 'd') persistent = 1;
+        else if (opt == 'i') idle_s = atoi(optarg);
+        else if (opt == 'r') ready_fd = atoi(optarg);
+        else { usage(argv[0]); return 1; }
+    }
+    if (threads < 1) threads = 1;
+    if (persistent) setvbuf(stdout, NULL, _IOLBF, 0); // log file, not a terminal
+
+    signal(SIGPIPE, SIG_IGN);
+
+    server_t srv;
+    memset(&srv, 0, sizeof(srv));
+    srv.running = 1;
+    srv.stats_fd = -1;
+    srv.signal_fd = -1;
+    srv.persistent = persistent;
+    srv.idle_fd = -1;
+    srv.idle_s = idle_s;
+    srv.rec_dir = rec_dir;
+    srv.arena_bots = arena_bots < 0 ? 0 : arena_bots;
+    srv.arena_w = arena_w;
+    srv.arena_h = arena_h;
+
+    if (map_catalog_load(&srv.maps, MAPS_FILE) < 0) perror(MAPS_FILE);
+    for (int i = 0; i < srv.maps.n; i++) {
+        const map_t *m = srv.maps.maps[i];
+        printf("[server] Map %d: %s %dx%d\n", i + 1, m->name, m->obst.w, m->obst.h);
+    }
 
-        if (st->session_active && !st->gameover && st->mode == MODE_TIMED) {
-            if (time_left_s(st) <= 0) st->gameover = 1;
+    // socket od systemd (socket activation) patrí jemu, cestu nemažeme
+    int activated = 0;
+    srv.listen_fd = ipc_server_activated();
+    if (srv.listen_fd >= 0) {
+        activated = 1;
+    } else {
+        srv.listen_fd = ipc_server_listen(SNAKE_SOCK_PATH);
+        if (srv.listen_fd < 0) {
+            perror("ipc_server_listen");
+            return 1;
         }
-
-        if (st->session_active && !st->paused && !st->gameover) tick_locked(st);
-
-        send_snapshot_locked(st);
-
-        pthread_mutex_unlock(&st->lock);
     }
-    return NULL;
-}
+    printf("[server] Listening on %s%s%s\n", SNAKE_SOCK_PATH, activated ? " (activated)" : "",
+           persistent ? ", persistent" : "");
+
+    srv.epoll_fd = epoll_create1(0);
+    if (srv.epoll_fd < 0 || epoll_add(srv.epoll_fd, srv.listen_fd, EPOLLIN, &listen_tag) != 0) {
+        perror("epoll");
+        close(srv.listen_fd);
+        if (!activated) unlink(SNAKE_SOCK_PATH);
+        return 1;
+    }
 
-static int wait_config_and_start(server_state_t *st) {
-    int got_mode = 0, got_time = 0, got_world = 0, got_size = 0;
-
-    // defaults
-    st->session_active = 0;
-    st->paused = 0;
-    st->pause_start_ts = 0;
-    st->paused_total_s = 0;
-    st->gameover = 0;
-
-    st->mode = MODE_STANDARD;
-    st->duration_s = 60;
-    st->world_type = WORLD_WRAP;
-    st->w = 20;
-    st->h = 15;
-    free_obstacles(st);
-
-    while (!(got_mode && got_world && got_size && (st->mode != MODE_TIMED || got_time))) {
-        msg_cmd_t cmd;
-        if (ipc_recv_all(st->client_fd, &cmd, sizeof(cmd)) != 0) return -1;
-
-        if (cmd.cmd == CMD_QUIT) return 1; // shutdown server
-
-        if (cmd.cmd == CMD_SET_MODE) {
-            if (cmd.arg == MODE_STANDARD || cmd.arg == MODE_TIMED) { st->mode = (game_mode_t)cmd.arg; got_mode = 1; }
-        } else if (cmd.cmd == CMD_SET_TIME) {
-            if (cmd.arg >= MIN_TIME && cmd.arg <= MAX_TIME) { st->duration_s = cmd.arg; got_time = 1; }
-        } else if (cmd.cmd == CMD_SET_WORLD) {
-            if (cmd.arg == WORLD_WRAP || cmd.arg == WORLD_OBSTACLES) {
-                st->world_type = (world_type_t)cmd.arg;
-                got_world = 1;
-                if (st->world_type == WORLD_OBSTACLES) { st->w = OB_W; st->h = OB_H; got_size = 1; }
-            }
-        } else if (cmd.cmd == CMD_SET_SIZE) {
-            if (st->world_type == WORLD_OBSTACLES) {
-                got_size = 1;
-            } else {
-                int w = (cmd.arg >> 16) & 0xFFFF;
-                int h = cmd.arg & 0xFFFF;
-                if (w >= MIN_W && w <= MAX_W && h >= MIN_H && h <= MAX_H) { st->w = w; st->h = h; got_size = 1; }
-            }
+    if (stats_s > 0) {
+        srv.stats_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+        if (srv.stats_fd < 0 || start_timer(srv.stats_fd, stats_s * 1000L) != 0 ||
+            epoll_add(srv.epoll_fd, srv.stats_fd, EPOLLIN, &stats_tag) != 0) {
+            perror("timerfd");
+            return 1;
         }
     }
 
-    ensure_buffers(st);
+    // blokované pred štartom workerov, ktoré masku zdedia; prídu cez epoll
+    sigset_t stop;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    if (pthread_sigmask(SIG_BLOCK, &stop, NULL) != 0 || (srv.signal_fd = signalfd(-1, &stop, 0)) < 0 ||
+        epoll_add(srv.epoll_fd, srv.signal_fd, EPOLLIN, &signal_tag) != 0) {
+        perror("signalfd");
+        return 1;
+    }
 
-    if (st->world_type == WORLD_OBSTACLES) {
-        if (load_obstacles(st, OB_FILE) != 0) {
-            fprintf(stderr, "[server] failed to load obstacles file: %s\n", OB_FILE);
-            return -1;
+    if (idle_s > 0) {
+        srv.idle_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+        if (srv.idle_fd < 0 || epoll_add(srv.epoll_fd, srv.idle_fd, EPOLLIN, &idle_tag) != 0) {
+            perror("timerfd");
+            return 1;
         }
     }
 
-    reset_game(st);
-    return 0;
-}
-
-int main(void) {
-    srand((unsigned)time(NULL));
-
-    int lfd = ipc_server_listen(SNAKE_SOCK_PATH);
-    printf("[server] Listening on %s\n", SNAKE_SOCK_PATH);
+    if (tsched_start(&srv.sched, threads) != 0) {
+        perror("tsched_start");
+        close(srv.listen_fd);
+        if (!activated) unlink(SNAKE_SOCK_PATH);
+        return 1;
+    }
+    printf("[server] %d tick worker(s)\n", srv.sched.nshards);
 
-    server_state_t st;
-    memset(&st, 0, sizeof(st));
-    st.running = 1;
-    st.client_fd = -1;
-    pthread_mutex_init(&st.lock, NULL);
+    if (nbots > 0) {
+        if (spawn_bots(&srv, nbots) != 0) perror("spawn_bots");
+        printf("[server] %d bot(s)\n", srv.nbots);
+    }
+    arm_idle(&srv);
 
-    pthread_t th;
-    if (pthread_create(&th, NULL, game_thread, &st) != 0) {
-        perror("pthread_create");
-        close(lfd);
-        unlink(SNAKE_SOCK_PATH);
-        return 1;
+    // kto nás spustil, čaká na tento bajt namiesto pollovania socketu
+    if (ready_fd >= 0) {
+        fflush(stdout);
+        if (write(ready_fd, "R", 1) != 1) perror("ready_fd");
+        close(ready_fd);
     }
 
-    while (st.running) {
-        int cfd = ipc_server_accept(lfd);
-        printf("[server] Client connected\n");
-
-        pthread_mutex_lock(&st.lock);
-        st.client_fd = cfd;
-        int cfg = wait_config_and_start(&st);
-        pthread_mutex_unlock(&st.lock);
-
-        if (cfg == 1) {
-            msg_resp_t bye = {RESP_BYE};
-            (void)ipc_send_all(cfd, &bye, sizeof(bye));
-            close(cfd);
-            st.client_fd = -1;
-            st.running = 0;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (srv.running) {
+        int n = epoll_wait(srv.epoll_fd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
             break;
         }
-        if (cfg != 0) {
-            close(cfd);
-            pthread_mutex_lock(&st.lock);
-            st.client_fd = -1;
-            st.session_active = 0;
-            pthread_mutex_unlock(&st.lock);
-            continue;
-        }
 
-        // session loop
-        for (;;) {
-            msg_cmd_t cmd;
-            if (ipc_recv_all(cfd, &cmd, sizeof(cmd)) != 0) {
-                pthread_mutex_lock(&st.lock);
-                st.session_active = 0;
-                st.client_fd = -1;
-                pthread_mutex_unlock(&st.lock);
-                close(cfd);
-                break;
-            }
-
-            pthread_mutex_lock(&st.lock);
-
-            if (cmd.cmd == CMD_DIR) {
-                st.requested_dir = (dir_t)cmd.arg;
-                pthread_mutex_unlock(&st.lock);
-                continue;
-            }
-
-            if (cmd.cmd == CMD_TOGGLE_PAUSE) {
-                if (!st.gameover) {
-                    if (!st.paused) {
-                        st.paused = 1;
-                        st.pause_start_ts = time(NULL);
-                    } else {
-                        st.paused = 0;
-                        if (st.pause_start_ts != 0) {
-                            int d = (int)difftime(time(NULL), st.pause_start_ts);
-                            if (d > 0) st.paused_total_s += d;
-                            st.pause_start_ts = 0;
-                        }
-                    }
-                }
-                pthread_mutex_unlock(&st.lock);
-                continue;
-            }
-
-            if (cmd.cmd == CMD_RESTART) {
-                reset_game(&st);
-                pthread_mutex_unlock(&st.lock);
-                continue;
-            }
-
-            if (cmd.cmd == CMD_BACK_TO_MENU) {
-                msg_resp_t bye = {RESP_BYE};
-                (void)ipc_send_all(cfd, &bye, sizeof(bye));
-                st.session_active = 0;
-                st.client_fd = -1;
-                pthread_mutex_unlock(&st.lock);
-                close(cfd);
-                break;
-            }
-
-            if (cmd.cmd == CMD_QUIT) {
-                msg_resp_t bye = {RESP_BYE};
-                (void)ipc_send_all(cfd, &bye, sizeof(bye));
-                st.session_active = 0;
-                st.client_fd = -1;
-                st.running = 0;
-                pthread_mutex_unlock(&st.lock);
-                close(cfd);
-                break;
-            }
-
-            pthread_mutex_unlock(&st.lock);
+        for (int i = 0; i < n && srv.running; i++) {
+            void *ptr = events[i].data.ptr;
+            if (ptr == &listen_tag) on_accept(&srv);
+            else if (ptr == &stats_tag) on_stats(&srv);
+            else if (ptr == &idle_tag) on_idle(&srv);
+            else if (ptr == &signal_tag) on_signal(&srv);
+            else on_client(&srv, (session_t *)ptr, events[i].events);
         }
-
     }
 
-    pthread_mutex_lock(&st.lock);
-    st.running = 0;
-    pthread_mutex_unlock(&st.lock);
-
-    pthread_join(th, NULL);
-
-    free(st.obst);
-    free(st.buf);
-    pthread_mutex_destroy(&st.lock);
-    close(lfd);
-    unlink(SNAKE_SOCK_PATH);
+    tsched_stop(&srv.sched);
+    while (srv.count > 0) remove_session(&srv, srv.sessions[0]);
+    for (int i = 0; i < srv.nbots; i++) session_destroy(srv.bots[i]);
+    free(srv.bots);
+    map_catalog_free(&srv.maps);
+
+    if (srv.stats_fd >= 0) close(srv.stats_fd);
+    if (srv.idle_fd >= 0) close(srv.idle_fd);
+    close(srv.signal_fd);
+    close(srv.epoll_fd);
+    close(srv.listen_fd);
+    if (!activated) unlink(SNAKE_SOCK_PATH);
     printf("[server] shutdown\n");
     return 0;
 }
@@ -0,0 +1,605 @@
+#include "session.h"
+
+#include "ipc.h"
+#include "tick_sched.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static void tick_node(tick_node_t *n) {
+    session_tick(TNODE_OWNER(n, session_t, node));
+}
+
+session_t *session_create(int id, int fd) {
+    session_t *s = (session_t *)calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->id = id;
+    s->fd = fd;
+    s->slot = -1;
+    cmd_ring_init(&s->cmds);
+    outq_init(&s->outq);
+    game_init(&s->game);
+    game_seed(&s->game, (uint64_t)mono_ns() ^ ((uint64_t)(unsigned)id << 32));
+    tnode_init(&s->node, tick_node, (int64_t)TICK_MS * 1000000LL);
+    pthread_mutex_init(&s->watch_lock, NULL);
+    s->watch_enc.delta_version = DELTA_VERSION;
+    return s;
+}
+
+void session_destroy(session_t *s) {
+    if (!s) return;
+    if (s->shm) {
+        ipc_shm_close(s->shm);
+        ipc_shm_unmap(s->shm, s->shm_size);
+    }
+    if (s->fd >= 0) close(s->fd);
+    rec_close(s->rec, &s->game);
+    if (s->bot) {
+        bot_free(s->bot);
+        free(s->bot);
+    }
+    game_free(&s->game);
+    free(s->enc.out);
+    free(s->watch_enc.out);
+    free(s->watchers);
+    pthread_mutex_destroy(&s->watch_lock);
+    outq_free(&s->outq);
+    free(s);
+}
+
+static int config_complete(const session_config_t *c) {
+    return c->got_mode && c->got_world && c->got_size &&
+           (c->mode != MODE_TIMED || c->got_time);
+}
+
+static void start_recording(session_t *s, uint64_t seed) {
+    const game_t *g = &s->game;
+    rec_header_t h = {
+        .seed = seed,
+        .map_hash = s->map ? s->map->hash : 0,
+        .mode = (uint8_t)g->mode,
+        .world = (uint8_t)g->world_type,
+        .w = (uint16_t)g->w,
+        .h = (uint16_t)g->h,
+        .duration_s = (uint16_t)g->duration_s,
+        .tick_ms = (uint16_t)(s->node.period_ns / 1000000LL),
+    };
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/session-%lld-%d" REC_EXT, s->rec_dir, (long long)time(NULL), s->id);
+    s->rec = rec_open(path, &h);
+    if (!s->rec) perror(path); // hra beží ďalej aj bez záznamu
+}
+
+// hash mapy pred prvým snapshotom, klient si mapu vypýta cez CMD_GET_MAP
+static void send_map_info(session_t *s) {
+    if (s->fd < 0) return;
+    const obst_map_t *o = &s->map->obst;
+    size_t top = sizeof(msg_hdr_t) + sizeof(msg_map_t) + (size_t)o->nspawns * sizeof(msg_point_t);
+    msg_hdr_t hdr = msg_hdr(RESP_MAP_INFO, sizeof(msg_map_t));
+    msg_map_t m = {s->map->hash, o->w, o->h, o->nspawns, (int32_t)(s->map->wire_len - top)};
+
+    unsigned char buf[sizeof(hdr) + sizeof(m)];
+    memcpy(buf, &hdr, sizeof(hdr));
+    memcpy(buf + sizeof(hdr), &m, sizeof(m));
+    (void)outq_send(&s->outq, s->fd, buf, sizeof(buf), OUTQ_CTRL);
+}
+
+// Segment na keyframe celej dosky a RESP_SHM s jeho fd. Kým je socket
+// prázdny, fd ide priamo sendmsg(); keď sa nedá, frames idú po sockete
+// ako bez CMD_SET_SHM. -1 len ak sa poslala časť rámca.
+static int open_shm(session_t *s) {
+    if (s->fd < 0 || outq_pending(&s->outq) > 0) return 0;
+
+    size_t cap = sizeof(msg_hdr_t) + sizeof(msg_snapshot_t) + (size_t)s->game.w * (size_t)s->game.h * sizeof(msg_point_t);
+    ipc_shm_t *m;
+    size_t size;
+    int mfd = ipc_shm_create(cap, &m, &size);
+    if (mfd < 0) {
+        perror("memfd");
+        return 0;
+    }
+
+    msg_hdr_t hdr = msg_hdr(RESP_SHM, 0);
+    ssize_t r = ipc_send_fd(s->fd, &hdr, sizeof(hdr), mfd);
+    close(mfd);
+    if (r <= 0) {
+        ipc_shm_unmap(m, size);
+        return 0;
+    }
+    s->shm = m;
+    s->shm_size = size;
+    if ((size_t)r < sizeof(hdr)) return outq_send(&s->outq, s->fd, (unsigned char *)&hdr + r, sizeof(hdr) - (size_t)r, OUTQ_CTRL);
+    return 0;
+}
+
+// skopíruje hotový config do hry a spustí ju
+static session_rc_t commit_config(session_t *s) {
+    const session_config_t *c = &s->cfg;
+    game_t *g = &s->game;
+
+    g->mode = c->mode;
+    g->duration_s = c->duration_s;
+    g->world_type = c->world_type;
+    g->w = c->w;
+    g->h = c->h;
+
+    // mapa je z katalógu servera, hra si ju len požičia
+    if (g->world_type == WORLD_OBSTACLES) {
+        int id = c->map > 0 ? c->map : 1;
+        const map_t *m = s->maps ? map_catalog_get(s->maps, id) : NULL;
+        if (!m) {
+            fprintf(stderr, "[server] no map %d in the catalog (%s)\n", id, MAPS_FILE);
+            return SESSION_CLOSE;
+        }
+        g->w = m->obst.w;
+        g->h = m->obst.h;
+        (void)game_set_obstacles(g, &m->obst);
+        s->map = m;
+    }
+
+    uint64_t seed = g->rng;
+    int64_t now = mono_ns();
+    if (game_reset(g, now) != 0) {
+        perror("calloc");
+        return SESSION_CLOSE;
+    }
+    // herný čas = plánovaný čas ticku, prvý tick o jednu periódu
+    s->node.deadline_ns = s->node.clock_ns = now + s->node.period_ns;
+    s->state = SESSION_ACTIVE;
+
+    if (c->shm && open_shm(s) != 0) return SESSION_CLOSE;
+    if (s->map) send_map_info(s);
+    if (s->rec_dir) start_recording(s, seed);
+    return SESSION_OK;
+}
+
+// len zapisuje do s->cfg, hra sa mení až v commit_config
+static session_rc_t on_config_cmd(session_t *s, const msg_cmd_t *cmd) {
+    session_config_t *c = &s->cfg;
+
+    if (cmd->cmd == CMD_JOIN_ARENA) {
+        if (cmd->arg >= 1 && cmd->arg <= MAX_ARENAS) c->arena = cmd->arg; // join robí server
+        return SESSION_OK;
+    }
+    if (cmd->cmd == CMD_SPECTATE) {
+        if (cmd->arg > 0) c->watch = cmd->arg; // hru hľadá server
+        return SESSION_OK;
+    }
+    if (cmd->cmd == CMD_SET_MODE) {
+        if (cmd->arg == MODE_STANDARD || cmd->arg == MODE_TIMED) { c->mode = (game_mode_t)cmd->arg; c->got_mode = 1; }
+    } else if (cmd->cmd == CMD_SET_TIME) {
+        if (cmd->arg >= MIN_TIME && cmd->arg <= MAX_TIME) { c->duration_s = cmd->arg; c->got_time = 1; }
+    } else if (cmd->cmd == CMD_SET_WORLD) {
+        if (cmd->arg == WORLD_WRAP || cmd->arg == WORLD_OBSTACLES) {
+            c->world_type = (world_type_t)cmd->arg;
+            c->got_world = 1;
+            if (c->world_type == WORLD_OBSTACLES) c->got_size = 1; // size of the map
+        }
+    } else if (cmd->cmd == CMD_SET_SHM) {
+        c->shm = cmd->arg == 1;
+    } else if (cmd->cmd == CMD_SET_MAP) {
+        if (s->maps && map_catalog_get(s->maps, cmd->arg)) c->map = cmd->arg;
+    } else if (cmd->cmd == CMD_SET_SIZE) {
+        if (c->got_world && c->world_type == WORLD_OBSTACLES) {
+            c->got_size = 1;
+        } else {
+            int w = (cmd->arg >> 16) & 0xFFFF;
+            int h = cmd->arg & 0xFFFF;
+            if (w >= MIN_W && w <= MAX_W && h >= MIN_H && h <= MAX_H) { c->w = w; c->h = h; c->got_size = 1; }
+        }
+    }
+
+    if (config_complete(c)) return commit_config(s);
+    return SESSION_OK;
+}
+
+// príkazy, ktoré menia stav hry; po štarte ich vykonáva len tick worker
+static void apply_cmd(session_t *s, const msg_cmd_t *cmd, int64_t now) {
+    game_t *g = &s->game;
+
+    if (s->rec) rec_cmd(s->rec, cmd);
+
+    if (cmd->cmd == CMD_SET_TICK) {
+        if (cmd->arg >= MIN_TICK_MS && cmd->arg <= MAX_TICK_MS) s->node.period_ns = (int64_t)cmd->arg * 1000000LL;
+    } else if (cmd->cmd == CMD_SET_DELTA) {
+        s->enc.delta_version = (cmd->arg == DELTA_VERSION) ? DELTA_VERSION : 0;
+        s->enc.need_keyframe = 1;
+    } else if (cmd->cmd == CMD_KEYFRAME) {
+        s->enc.need_keyframe = 1;
+    } else if (cmd->cmd == CMD_SET_VIEW) {
+        session_set_view(s, cmd->arg);
+    } else if (!g->active) {
+        return;
+    } else if (cmd->cmd == CMD_DIR) {
+        game_queue_turn(g, 0, (dir_t)cmd->arg);
+    } else if (cmd->cmd == CMD_TOGGLE_PAUSE) {
+        game_toggle_pause(g, now);
+    } else if (cmd->cmd == CMD_RESTART) {
+        (void)game_reset(g, now); // same size, buffers already there
+    }
+}
+
+// divák hru len sleduje: QUIT aj návrat do menu ukončia jeho pripojenie
+static session_rc_t on_watcher_cmd(session_t *s, const msg_cmd_t *cmd) {
+    if (cmd->cmd == CMD_QUIT || cmd->cmd == CMD_BACK_TO_MENU) {
+        msg_hdr_t bye = msg_hdr(RESP_BYE, 0);
+        (void)outq_send(&s->outq, s->fd, &bye, sizeof(bye), OUTQ_CTRL);
+        s->state = SESSION_ENDED;
+        return SESSION_CLOSE;
+    }
+    if (cmd->cmd == CMD_KEYFRAME && s->watching) {
+        pthread_mutex_lock(&s->watching->watch_lock);
+        s->watch_new = 1;
+        pthread_mutex_unlock(&s->watching->watch_lock);
+    } else if (cmd->cmd == CMD_GET_MAP && s->map) {
+        if (outq_send(&s->outq, s->fd, s->map->wire, s->map->wire_len, OUTQ_CTRL) != 0) return SESSION_CLOSE;
+    }
+    return SESSION_OK;
+}
+
+session_rc_t session_on_cmd(session_t *s, const msg_cmd_t *cmd) {
+    if (s->state == SESSION_ENDED) return SESSION_CLOSE;
+    if (s->state == SESSION_WATCHING) return on_watcher_cmd(s, cmd);
+
+    if (cmd->cmd == CMD_QUIT || (cmd->cmd == CMD_BACK_TO_MENU && s->state == SESSION_ACTIVE)) {
+        msg_hdr_t bye = msg_hdr(RESP_BYE, 0);
+        (void)outq_send(&s->outq, s->fd, &bye, sizeof(bye), OUTQ_CTRL);
+        s->state = SESSION_ENDED;
+        return SESSION_CLOSE;
+    }
+
+    if (s->state == SESSION_AWAIT_CONFIG) {
+        if (cmd->cmd == CMD_SET_DELTA || cmd->cmd == CMD_KEYFRAME || cmd->cmd == CMD_SET_TICK ||
+            cmd->cmd == CMD_SET_VIEW) apply_cmd(s, cmd, 0);
+        else return on_config_cmd(s, cmd);
+        return SESSION_OK;
+    }
+
+    // mapa sa nemení, posiela sa rovno z epoll vlákna
+    if (cmd->cmd == CMD_GET_MAP) {
+        if (s->map && outq_send(&s->outq, s->fd, s->map->wire, s->map->wire_len, OUTQ_CTRL) != 0) return SESSION_CLOSE;
+        return SESSION_OK;
+    }
+
+    // hra beží: stav patrí tick workeru, príkaz ide cez SPSC frontu
+    if (cmd_ring_push(&s->cmds, cmd) != 0) s->cmds_dropped++;
+    return SESSION_OK;
+}
+
+int session_attach_bot(session_t *s) {
+    if (s->state != SESSION_ACTIVE || s->bot) return -1;
+    s->bot = (bot_t *)malloc(sizeof(*s->bot));
+    if (!s->bot) return -1;
+    if (bot_init(s->bot, s->game.w * s->game.h) != 0) {
+        free(s->bot);
+        s->bot = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void session_set_view(session_t *s, int32_t arg) {
+    int cols = (arg >> 16) & 0xFFFF;
+    int rows = arg & 0xFFFF;
+    s->enc.view_w = cols > 0 ? cols + 2 * VIEW_MARGIN : 0;
+    s->enc.view_h = rows > 0 ? rows + 2 * VIEW_MARGIN : 0;
+    s->enc.need_keyframe = 1;
+}
+
+// Všetky celé rámce v inbuf priamo z neho, zvyšok sa posunie na začiatok.
+// Príkazy sú krátke, rámec, ktorý sa do inbuf nezmestí, je chyba.
+static session_rc_t on_frames(session_t *s) {
+    size_t off = 0;
+    session_rc_t rc = SESSION_OK;
+    while (rc == SESSION_OK) {
+        msg_hdr_t h;
+        const unsigned char *p;
+        ssize_t n = ipc_frame_parse(s->inbuf + off, s->in_len - off, sizeof(s->inbuf) - sizeof(h), &h, &p);
+        if (n < 0) return SESSION_CLOSE;
+        if (n == 0) break;
+        off += (size_t)n;
+
+        msg_cmd_t cmd = {h.type, 0};
+        if (h.len >= sizeof(cmd.arg)) memcpy(&cmd.arg, p, sizeof(cmd.arg));
+        rc = session_on_cmd(s, &cmd);
+    }
+    memmove(s->inbuf, s->inbuf + off, s->in_len - off);
+    s->in_len -= off;
+    return rc;
+}
+
+session_rc_t session_on_readable(session_t *s) {
+    for (;;) {
+        ssize_t r = read(s->fd, s->inbuf + s->in_len, sizeof(s->inbuf) - s->in_len);
+        if (r == 0) return SESSION_CLOSE;
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? SESSION_OK : SESSION_CLOSE;
+        }
+        s->in_len += (size_t)r;
+        session_rc_t rc = on_frames(s);
+        if (rc != SESSION_OK) return rc;
+    }
+}
+
+// ukončená session (divák po BYE) sa zatvorí, keď sa fronta vyprázdni
+session_rc_t session_on_writable(session_t *s) {
+    if (outq_flush(&s->outq, s->fd) != 0) return SESSION_CLOSE;
+    return (s->state == SESSION_ENDED && outq_pending(&s->outq) == 0) ? SESSION_CLOSE : SESSION_OK;
+}
+
+static unsigned char *out_reserve(snap_enc_t *e, size_t n) {
+    if (n > e->out_cap) {
+        unsigned char *p = (unsigned char *)realloc(e->out, n);
+        if (!p) return NULL;
+        e->out = p;
+        e->out_cap = n;
+    }
+    return e->out;
+}
+
+// hlavička, snapshot a body hada vo výreze za sebou v jednom bufferi
+static size_t encode_snapshot(snap_enc_t *e, const game_t *g) {
+    const snake_t *sn = &g->snakes[0];
+    if (!g->active) return 0;
+
+    size_t head = sizeof(msg_hdr_t) + sizeof(msg_snapshot_t);
+    unsigned char *p = out_reserve(e, head + (size_t)sn->len * sizeof(msg_point_t));
+    if (!p) return 0;
+
+
+    msg_snapshot_t m;
+    m.w = g->w;
+    m.h = g->h;
+    m.score = sn->score;
+    m.paused = g->paused;
+    m.gameover = g->gameover;
+    m.fruit_x = g->fruit_x;
+    m.fruit_y = g->fruit_y;
+    m.snake_len = sn->len;
+    msg_point_t hp = sn->len > 0 ? game_snake_get(g, 0, 0) : (msg_point_t){(int16_t)(g->w / 2), (int16_t)(g->h / 2)};
+    m.view = game_view(g, hp.x, hp.y, e->view_w, e->view_h);
+    int has_head;
+    m.npoints = game_snake_clip(g, 0, m.view, (msg_point_t *)(void *)(p + head), &has_head);
+    m.mode = g->mode;
+    m.elapsed_s = game_elapsed_s(g);
+    m.time_left_s = game_time_left_s(g);
+    m.seq = ++e->seq;
+
+    msg_hdr_t hdr = msg_hdr(RESP_SNAPSHOT, (uint32_t)(sizeof(m) + (size_t)m.npoints * sizeof(msg_point_t)));
+    memcpy(p, &hdr, sizeof(hdr));
+    memcpy(p + sizeof(hdr), &m, sizeof(m));
+
+    e->last = m;
+    e->last_culled = m.npoints < sn->len;
+    e->last_epoch = g->epoch;
+    e->last_pushes = sn->pushes;
+    e->last_pops = sn->pops;
+    e->since_keyframe = 0;
+    e->need_keyframe = 0;
+    e->out_kind = OUTQ_KEY;
+    return head + (size_t)m.npoints * sizeof(msg_point_t);
+}
+
+static int delta_possible(const snap_enc_t *e, const game_t *g) {
+    const snake_t *sn = &g->snakes[0];
+    if (!e->delta_version || e->need_keyframe || e->last_culled) return 0;
+    if (e->since_keyframe >= KEYFRAME_TICKS) return 0;
+    if (g->epoch != e->last_epoch || g->w != e->last.w || g->h != e->last.h) return 0;
+    if (sn->pushes - e->last_pushes > 1) return 0;
+    if (sn->pops - e->last_pops > UINT16_MAX) return 0;
+
+    // nová hlava mimo výrezu keyframe -> nový keyframe okolo nej
+    if (sn->len > 0) {
+        msg_point_t hp = game_snake_get(g, 0, 0);
+        const msg_rect_t *v = &e->last.view;
+        if ((unsigned)(hp.x - v->x) >= (unsigned)v->w || (unsigned)(hp.y - v->y) >= (unsigned)v->h) return 0;
+    }
+
+    int ds = sn->score - e->last.score;
+    return ds >= INT16_MIN && ds <= INT16_MAX;
+}
+
+static size_t encode_delta(snap_enc_t *e, const game_t *g) {
+    const snake_t *sn = &g->snakes[0];
+
+    size_t n = sizeof(msg_hdr_t) + sizeof(msg_delta_t);
+    unsigned char *p = out_reserve(e, n);
+    if (!p) return 0;
+
+    msg_hdr_t hdr = msg_hdr(RESP_DELTA, sizeof(msg_delta_t));
+
+    msg_delta_t d;
+    memset(&d, 0, sizeof(d));
+    d.version = DELTA_VERSION;
+    d.tail_pops = (uint16_t)(sn->pops - e->last_pops);
+    d.seq = ++e->seq;
+    if (sn->pushes != e->last_pushes) {
+        d.flags |= DELTA_HEAD;
+        d.head = game_snake_get(g, 0, 0);
+    }
+    if (g->fruit_x != e->last.fruit_x || g->fruit_y != e->last.fruit_y) {
+        d.flags |= DELTA_FRUIT;
+        d.fruit = (msg_point_t){(int16_t)g->fruit_x, (int16_t)g->fruit_y};
+    }
+    if (sn->score != e->last.score) {
+        d.flags |= DELTA_SCORE;
+        d.score_delta = (int16_t)(sn->score - e->last.score);
+    }
+    d.paused = (uint8_t)g->paused;
+    d.gameover = (uint8_t)g->gameover;
+    d.elapsed_s = game_elapsed_s(g);
+    d.time_left_s = game_time_left_s(g);
+
+    memcpy(p, &hdr, sizeof(hdr));
+    memcpy(p + sizeof(hdr), &d, sizeof(d));
+
+    e->last.score = sn->score;
+    e->last.fruit_x = g->fruit_x;
+    e->last.fruit_y = g->fruit_y;
+    e->last.snake_len = sn->len;
+    e->last.seq = d.seq;
+    e->last_pushes = sn->pushes;
+    e->last_pops = sn->pops;
+    e->since_keyframe++;
+    e->out_kind = OUTQ_DELTA;
+    return n;
+}
+
+static size_t encode_frame(snap_enc_t *e, const game_t *g) {
+    if (!g->active) return 0;
+    if (delta_possible(e, g)) return encode_delta(e, g);
+    return encode_snapshot(e, g);
+}
+
+size_t session_encode_snapshot(session_t *s) {
+    return encode_snapshot(&s->enc, &s->game);
+}
+
+size_t session_encode_frame(session_t *s) {
+    // výstupná fronta zahodila deltu -> klient potrebuje keyframe
+    if (atomic_exchange(&s->outq.resync, 0)) s->enc.need_keyframe = 1;
+    return encode_frame(&s->enc, &s->game);
+}
+
+// s RESP_SHM celý keyframe každý tick do zdieľanej pamäte, delty netreba
+static void queue_frame(session_t *s, size_t n) {
+    if (n == 0 || s->fd < 0) return;
+    if (s->shm) {
+        ipc_shm_publish(s->shm, s->enc.out, n);
+        return;
+    }
+    (void)outq_send(&s->outq, s->fd, s->enc.out, n, s->enc.out_kind);
+}
+
+static size_t encode_own(session_t *s) {
+    return s->shm ? session_encode_snapshot(s) : session_encode_frame(s);
+}
+
+void session_send_frame(session_t *s) {
+    queue_frame(s, encode_own(s));
+}
+
+// Jeden frame pre všetkých divákov: zakóduje sa raz a každá fronta
+// dostane referenciu na ten istý buffer. Divák, ktorému fronta zahodila
+// frame, dostáva len keyframes, kým ju nevyprázdni; nový divák si
+// vynúti keyframe pre všetkých.
+static void fan_out(session_t *s) {
+    pthread_mutex_lock(&s->watch_lock);
+    if (s->nwatchers == 0) {
+        pthread_mutex_unlock(&s->watch_lock);
+        return;
+    }
+
+    for (int i = 0; i < s->nwatchers; i++) {
+        session_t *w = s->watchers[i];
+        if (atomic_exchange(&w->outq.resync, 0)) w->watch_slow = 1;
+        if (w->watch_new) s->watch_enc.need_keyframe = 1;
+    }
+
+    size_t n = encode_frame(&s->watch_enc, &s->game);
+    outq_shared_t *b = n ? outq_shared_new(s->watch_enc.out, n) : NULL;
+    if (b) {
+        outq_kind_t kind = s->watch_enc.out_kind;
+        for (int i = 0; i < s->nwatchers; i++) {
+            session_t *w = s->watchers[i];
+            if (kind == OUTQ_KEY) {
+                if (w->watch_slow && outq_pending(&w->outq) == 0) w->watch_slow = 0;
+                w->watch_new = 0;
+            } else if (w->watch_new || w->watch_slow) {
+                continue;
+            }
+            (void)outq_send_shared(&w->outq, w->fd, b, kind);
+        }
+        outq_shared_put(b);
+    }
+    pthread_mutex_unlock(&s->watch_lock);
+}
+
+int session_watch(session_t *w, session_t *target) {
+    pthread_mutex_lock(&target->watch_lock);
+    if (target->nwatchers == target->watchers_cap) {
+        int cap = target->watchers_cap ? 2 * target->watchers_cap : 8;
+        session_t **p = (session_t **)realloc(target->watchers, (size_t)cap * sizeof(*p));
+        if (!p) {
+            pthread_mutex_unlock(&target->watch_lock);
+            return -1;
+        }
+        target->watchers = p;
+        target->watchers_cap = cap;
+    }
+    target->watchers[target->nwatchers++] = w;
+    w->watching = target;
+    w->watch_new = 1;
+    w->watch_slow = 0;
+    w->map = target->map;
+    w->state = SESSION_WATCHING;
+    pthread_mutex_unlock(&target->watch_lock);
+
+    // mapa je zdieľaná a nemení sa, hash ide hneď
+    if (w->map) send_map_info(w);
+    return 0;
+}
+
+void session_unwatch(session_t *w) {
+    session_t *t = w->watching;
+    if (!t) return;
+    pthread_mutex_lock(&t->watch_lock);
+    for (int i = 0; i < t->nwatchers; i++) {
+        if (t->watchers[i] == w) {
+            t->watchers[i] = t->watchers[--t->nwatchers];
+            break;
+        }
+    }
+    w->watching = NULL;
+    pthread_mutex_unlock(&t->watch_lock);
+}
+
+session_t **session_drop_watchers(session_t *s, int *n) {
+    msg_hdr_t bye = msg_hdr(RESP_BYE, 0);
+    pthread_mutex_lock(&s->watch_lock);
+    session_t **ended = s->watchers;
+    *n = s->nwatchers;
+    for (int i = 0; i < s->nwatchers; i++) {
+        session_t *w = s->watchers[i];
+        (void)outq_send(&w->outq, w->fd, &bye, sizeof(bye), OUTQ_CTRL);
+        w->watching = NULL;
+        w->state = SESSION_ENDED;
+    }
+    s->watchers = NULL;
+    s->nwatchers = s->watchers_cap = 0;
+    pthread_mutex_unlock(&s->watch_lock);
+    return ended;
+}
+
+void session_tick(session_t *s) {
+    if (!s->game.active) return;
+
+    int64_t now = s->node.clock_ns;
+    msg_cmd_t cmd;
+    while (cmd_ring_pop(&s->cmds, &cmd)) apply_cmd(s, &cmd, now);
+
+    // bot ide cez apply_cmd ako hráč, takže sa aj nahrá
+    if (s->bot) {
+        if (s->game.gameover) {
+            cmd = (msg_cmd_t){CMD_RESTART, 0};
+            apply_cmd(s, &cmd, now);
+        } else {
+            dir_t d = bot_think(s->bot, &s->game, 0);
+            if (d != s->game.snakes[0].dir) {
+                cmd = (msg_cmd_t){CMD_DIR, (int32_t)d};
+                apply_cmd(s, &cmd, now);
+            }
+        }
+    }
+
+    game_tick(&s->game, now);
+    if (s->rec) rec_tick(s->rec);
+    queue_frame(s, encode_own(s));
+    fan_out(s);
+}
@@ -0,0 +1,309 @@
+#define _DEFAULT_SOURCE
+
+#include "tick_sched.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* ===================== min-heap podľa deadline ===================== */
+
+static void heap_swap(shard_t *sh, int a, int b) {
+    tick_node_t *t = sh->heap[a];
+    sh->heap[a] = sh->heap[b];
+    sh->heap[b] = t;
+    sh->heap[a]->heap_idx = a;
+    sh->heap[b]->heap_idx = b;
+}
+
+static void heap_up(shard_t *sh, int i) {
+    while (i > 0) {
+        int p = (i - 1) / 2;
+        if (sh->heap[p]->deadline_ns <= sh->heap[i]->deadline_ns) break;
+        heap_swap(sh, p, i);
+        i = p;
+    }
+}
+
+static void heap_down(shard_t *sh, int i) {
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < sh->heap_len && sh->heap[l]->deadline_ns < sh->heap[m]->deadline_ns) m = l;
+        if (r < sh->heap_len && sh->heap[r]->deadline_ns < sh->heap[m]->deadline_ns) m = r;
+        if (m == i) break;
+        heap_swap(sh, i, m);
+        i = m;
+    }
+}
+
+static void heap_push(shard_t *sh, tick_node_t *n) {
+    if (sh->heap_len == sh->heap_cap) {
+        int cap = sh->heap_cap ? sh->heap_cap * 2 : 64;
+        tick_node_t **h = (tick_node_t **)realloc(sh->heap, (size_t)cap * sizeof(*h));
+        if (!h) { perror("realloc"); exit(1); }
+        sh->heap = h;
+        sh->heap_cap = cap;
+    }
+    n->heap_idx = sh->heap_len;
+    sh->heap[sh->heap_len++] = n;
+    heap_up(sh, n->heap_idx);
+}
+
+static void heap_remove(shard_t *sh, tick_node_t *n) {
+    int i = n->heap_idx;
+    n->heap_idx = -1;
+    if (--sh->heap_len == i) return;
+    sh->heap[i] = sh->heap[sh->heap_len];
+    sh->heap[i]->heap_idx = i;
+    heap_up(sh, i);
+    heap_down(sh, sh->heap[i]->heap_idx);
+}
+
+/* ===================== worker ===================== */
+
+static void abs_timespec(int64_t ns, struct timespec *ts) {
+    ts->tv_sec = (time_t)(ns / 1000000000LL);
+    ts->tv_nsec = (long)(ns % 1000000000LL);
+}
+
+// volá sa so zamknutým sh po dokončení ticku session n
+static void finish_tick(shard_t *sh, tick_node_t *n, int64_t lag) {
+    sh->ticks++;
+    sh->lag_sum_ns += lag;
+    if (lag > sh->lag_max_ns) sh->lag_max_ns = lag;
+    if (lag > n->period_ns) sh->late++;
+
+    // zmeškané periódy (aj pri ukradnutom uzle) sa preskočia celé,
+    // inak by ich worker dobiehal tickami hneď za sebou; herné hodiny
+    // idú ďalej o jednu periódu, aby sedel záznam (start + súčet periód)
+    int64_t now = mono_ns();
+    n->clock_ns += n->period_ns;
+    n->deadline_ns += n->period_ns;
+    if (n->deadline_ns <= now)
+        n->deadline_ns += ((now - n->deadline_ns) / n->period_ns + 1) * n->period_ns;
+
+    if (n->removing) {
+        atomic_fetch_sub(&sh->count, 1);
+        atomic_store(&n->shard, -1);
+        pthread_cond_broadcast(&sh->cond);
+        return;
+    }
+    heap_push(sh, n);
+}
+
+// Prevezme najviac meškajúci uzol z iného shardu. Volá sa bez zámku.
+static tick_node_t *steal(shard_t *self, int64_t now) {
+    tick_sched_t *ts = self->owner;
+    for (int k = 1; k < ts->nshards; k++) {
+        shard_t *v = &ts->shards[(self->index + k) % ts->nshards];
+        if (pthread_mutex_trylock(&v->lock) != 0) continue;
+
+        tick_node_t *n = NULL;
+        if (v->heap_len > 0 && now - v->heap[0]->deadline_ns > STEAL_LAG_NS) {
+            n = v->heap[0];
+            heap_remove(v, n);
+            atomic_fetch_sub(&v->count, 1);
+            atomic_store(&n->shard, self->index);
+        }
+        pthread_mutex_unlock(&v->lock);
+
+        if (n) {
+            pthread_mutex_lock(&self->lock);
+            atomic_fetch_add(&self->count, 1);
+            self->stolen++;
+            pthread_mutex_unlock(&self->lock);
+            return n;
+        }
+    }
+    return NULL;
+}
+
+// Meškajúci shard zobudí jeden spiaci, ten si z neho ukradne uzol.
+// Volá sa bez zámku; zmeškané zobudenie napraví ďalší tick.
+static void wake_idle(shard_t *self) {
+    tick_sched_t *ts = self->owner;
+    for (int k = 1; k < ts->nshards; k++) {
+        shard_t *v = &ts->shards[(self->index + k) % ts->nshards];
+        if (!atomic_load(&v->sleeping)) continue;
+        pthread_mutex_lock(&v->lock);
+        pthread_cond_broadcast(&v->cond);
+        pthread_mutex_unlock(&v->lock);
+        return;
+    }
+}
+
+static void *worker(void *arg) {
+    shard_t *sh = (shard_t *)arg;
+    tick_sched_t *ts = sh->owner;
+
+    pthread_mutex_lock(&sh->lock);
+    while (ts->running) {
+        int64_t now = mono_ns();
+
+        tick_node_t *n = NULL;
+        int lagging = 0;
+        if (sh->heap_len > 0 && sh->heap[0]->deadline_ns <= now) {
+            n = sh->heap[0];
+            heap_remove(sh, n);
+            lagging = ts->nshards > 1 && sh->heap_len > 0 && now - sh->heap[0]->deadline_ns > STEAL_LAG_NS;
+        } else {
+            pthread_mutex_unlock(&sh->lock);
+            n = steal(sh, now);
+            pthread_mutex_lock(&sh->lock);
+        }
+
+        if (n) {
+            pthread_mutex_unlock(&sh->lock);
+            if (lagging) wake_idle(sh);
+            int64_t lag = now - n->deadline_ns;
+            n->tick(n);
+            pthread_mutex_lock(&sh->lock);
+            finish_tick(sh, n, lag);
+            continue;
+        }
+
+        // spí do vlastného deadline; meškajúci sused ho zobudí cez wake_idle
+        atomic_store(&sh->sleeping, 1);
+        if (sh->heap_len > 0) {
+            struct timespec until;
+            abs_timespec(sh->heap[0]->deadline_ns, &until);
+            pthread_cond_timedwait(&sh->cond, &sh->lock, &until);
+        } else {
+            pthread_cond_wait(&sh->cond, &sh->lock);
+        }
+        atomic_store(&sh->sleeping, 0);
+    }
+    pthread_mutex_unlock(&sh->lock);
+    return NULL;
+}
+
+/* ===================== API ===================== */
+
+void tnode_init(tick_node_t *n, void (*tick)(tick_node_t *n), int64_t period_ns) {
+    n->tick = tick;
+    atomic_init(&n->shard, -1);
+    n->heap_idx = -1;
+    n->removing = 0;
+    n->deadline_ns = 0;
+    n->clock_ns = 0;
+    n->period_ns = period_ns;
+}
+
+int tsched_start(tick_sched_t *ts, int nthreads) {
+    if (nthreads < 1) nthreads = 1;
+    memset(ts, 0, sizeof(*ts));
+    ts->shards = (shard_t *)calloc((size_t)nthreads, sizeof(shard_t));
+    if (!ts->shards) return -1;
+    ts->nshards = nthreads;
+    ts->running = 1;
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+
+    for (int i = 0; i < nthreads; i++) {
+        shard_t *sh = &ts->shards[i];
+        sh->index = i;
+        sh->owner = ts;
+        pthread_mutex_init(&sh->lock, NULL);
+        pthread_cond_init(&sh->cond, &ca);
+    }
+    pthread_condattr_destroy(&ca);
+
+    for (int i = 0; i < nthreads; i++) {
+        if (pthread_create(&ts->shards[i].th, NULL, worker, &ts->shards[i]) != 0) {
+            ts->nshards = i;
+            tsched_stop(ts);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void tsched_stop(tick_sched_t *ts) {
+    for (int i = 0; i < ts->nshards; i++) pthread_mutex_lock(&ts->shards[i].lock);
+    ts->running = 0;
+    for (int i = 0; i < ts->nshards; i++) {
+        pthread_cond_broadcast(&ts->shards[i].cond);
+        pthread_mutex_unlock(&ts->shards[i].lock);
+    }
+
+    for (int i = 0; i < ts->nshards; i++) pthread_join(ts->shards[i].th, NULL);
+
+    for (int i = 0; i < ts->nshards; i++) {
+        shard_t *sh = &ts->shards[i];
+        for (int k = 0; k < sh->heap_len; k++) atomic_store(&sh->heap[k]->shard, -1);
+        free(sh->heap);
+        pthread_mutex_destroy(&sh->lock);
+        pthread_cond_destroy(&sh->cond);
+    }
+    free(ts->shards);
+    ts->shards = NULL;
+    ts->nshards = 0;
+}
+
+void tsched_add(tick_sched_t *ts, tick_node_t *n) {
+    // počty sa čítajú bez zámkov, výber je len odhad
+    shard_t *best = &ts->shards[0];
+    int best_count = atomic_load(&best->count);
+    for (int i = 1; i < ts->nshards; i++) {
+        int c = atomic_load(&ts->shards[i].count);
+        if (c < best_count) { best = &ts->shards[i]; best_count = c; }
+    }
+
+    pthread_mutex_lock(&best->lock);
+    n->removing = 0;
+    if (n->deadline_ns == 0) n->deadline_ns = n->clock_ns = mono_ns() + n->period_ns;
+    atomic_store(&n->shard, best->index);
+    atomic_fetch_add(&best->count, 1);
+    heap_push(best, n);
+    pthread_cond_signal(&best->cond);
+    pthread_mutex_unlock(&best->lock);
+}
+
+void tsched_remove(tick_sched_t *ts, tick_node_t *n) {
+    for (;;) {
+        int i = atomic_load(&n->shard);
+        if (i < 0 || i >= ts->nshards) return;
+
+        shard_t *sh = &ts->shards[i];
+        pthread_mutex_lock(&sh->lock);
+        if (atomic_load(&n->shard) != i) { pthread_mutex_unlock(&sh->lock); continue; }
+
+        if (n->heap_idx >= 0) {
+            heap_remove(sh, n);
+            atomic_fetch_sub(&sh->count, 1);
+            atomic_store(&n->shard, -1);
+        } else {
+            // práve sa tickuje, počkaj kým ho worker vráti
+            n->removing = 1;
+            while (atomic_load(&n->shard) == i) pthread_cond_wait(&sh->cond, &sh->lock);
+        }
+        pthread_mutex_unlock(&sh->lock);
+        return;
+    }
+}
+
+void tsched_stats(tick_sched_t *ts, int shard, shard_stats_t *out, int reset) {
+    shard_t *sh = &ts->shards[shard];
+    pthread_mutex_lock(&sh->lock);
+    out->sessions = atomic_load(&sh->count);
+    out->ticks = sh->ticks;
+    out->late = sh->late;
+    out->stolen = sh->stolen;
+    out->lag_avg_ns = sh->ticks ? sh->lag_sum_ns / (int64_t)sh->ticks : 0;
+    out->lag_max_ns = sh->lag_max_ns;
+    if (reset) {
+        sh->ticks = sh->late = sh->stolen = 0;
+        sh->lag_sum_ns = sh->lag_max_ns = 0;
+    }
+    pthread_mutex_unlock(&sh->lock);
+}